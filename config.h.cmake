@@ -1,3 +1,5 @@
 #define PACKAGE_VERSION "@CPACK_PACKAGE_VERSION@"
 
 #cmakedefine HAVE_SYS_WAIT_H
+
+#cmakedefine HAVE_ZLIB 1
@@ -92,3 +92,20 @@ parse_double_or_die (const char * input, const char * value_name)
 
 	return value ;
 } /* parse_double_or_die */
+
+void
+numbered_path (char * buf, size_t buflen, const char * path, int index)
+{	const char *ext, *slash ;
+
+	if (strcmp (path, "-") == 0)
+	{	snprintf (buf, buflen, "%s", path) ;
+		return ;
+		} ;
+
+	ext = strrchr (path, '.') ;
+	slash = strrchr (path, '/') ;
+	if (ext == NULL || (slash != NULL && ext < slash) || ext == path || ext [-1] == '/')
+		ext = path + strlen (path) ;
+
+	snprintf (buf, buflen, "%.*s-%04d%s", (int) (ext - path), path, index, ext) ;
+} /* numbered_path */
@@ -56,3 +56,6 @@ sf_count_t sfx_mix_mono_read_double (SNDFILE * file, double * data, sf_count_t d
 int parse_int_or_die (const char * input, const char * value_name) ;
 
 double parse_double_or_die (const char * input, const char * value_name) ;
+
+/* Insert "-NNNN" before the extension of path. The path "-" is returned unchanged. */
+void numbered_path (char * buf, size_t buflen, const char * path, int index) ;
@@ -0,0 +1,168 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "common.h"
+#include "peaks.h"
+#include "export.h"
+
+#define	EXPORT_VERSION		2
+
+/* Header flag for 8 bit data. */
+#define	FLAG_8_BIT			1
+
+typedef struct
+{	const PEAKS *peaks ;
+	int first, channels ;
+	int bits ;
+} EXPORT ;
+
+static int
+to_int (double value, int bits)
+{	double full = (1 << (bits - 1)) - 1 ;
+
+	return (int) MAX (-full - 1, MIN (full, lrint (value * full))) ;
+} /* to_int */
+
+/* Bin k of export channel ch, with the value of bins no frames fell in as 0. */
+static void
+get_bin (const EXPORT * export, int ch, int k, PEAK_BIN * bin)
+{
+	peaks_get (export->peaks, export->first < 0 ? -1 : export->first + ch, k, bin) ;
+
+	if (bin->count == 0)
+		bin->min = bin->max = 0.0 ;
+} /* get_bin */
+
+static bool
+write_le32 (FILE * file, int32_t value)
+{	unsigned char bytes [4] ;
+
+	bytes [0] = value & 0xff ;
+	bytes [1] = (value >> 8) & 0xff ;
+	bytes [2] = (value >> 16) & 0xff ;
+	bytes [3] = (value >> 24) & 0xff ;
+
+	return fwrite (bytes, 1, 4, file) == 4 ;
+} /* write_le32 */
+
+static bool
+write_dat (FILE * file, const EXPORT * export, int samplerate, int samples_per_pixel)
+{	unsigned char *row ;
+	int k, ch, len, bytes = export->bits / 8 ;
+	bool ok ;
+
+	ok = write_le32 (file, EXPORT_VERSION)
+		&& write_le32 (file, export->bits == 8 ? FLAG_8_BIT : 0)
+		&& write_le32 (file, samplerate)
+		&& write_le32 (file, samples_per_pixel)
+		&& write_le32 (file, export->peaks->bins)
+		&& write_le32 (file, export->channels) ;
+
+	if ((row = malloc (2 * bytes * export->channels)) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	for (k = 0 ; ok && k < export->peaks->bins ; k++)
+	{	len = 0 ;
+		for (ch = 0 ; ch < export->channels ; ch++)
+		{	PEAK_BIN bin ;
+			int min, max ;
+
+			get_bin (export, ch, k, &bin) ;
+			min = to_int (bin.min, export->bits) ;
+			max = to_int (bin.max, export->bits) ;
+
+			row [len++] = min & 0xff ;
+			if (bytes == 2)
+				row [len++] = (min >> 8) & 0xff ;
+			row [len++] = max & 0xff ;
+			if (bytes == 2)
+				row [len++] = (max >> 8) & 0xff ;
+			} ;
+
+		ok = fwrite (row, 1, len, file) == (size_t) len ;
+		} ;
+
+	free (row) ;
+	return ok ;
+} /* write_dat */
+
+static void
+write_json_array (FILE * file, const EXPORT * export, bool rms)
+{	const char *sep = "" ;
+	int k, ch ;
+
+	fprintf (file, "[") ;
+	for (k = 0 ; k < export->peaks->bins ; k++)
+		for (ch = 0 ; ch < export->channels ; ch++)
+		{	PEAK_BIN bin ;
+
+			get_bin (export, ch, k, &bin) ;
+			if (rms)
+				fprintf (file, "%s%d", sep, to_int (peaks_rms (export->peaks, &bin), export->bits)) ;
+			else
+				fprintf (file, "%s%d,%d", sep, to_int (bin.min, export->bits), to_int (bin.max, export->bits)) ;
+			sep = "," ;
+			} ;
+	fprintf (file, "]") ;
+} /* write_json_array */
+
+static void
+write_json (FILE * file, const EXPORT * export, int samplerate, int samples_per_pixel, bool with_rms)
+{
+	fprintf (file, "{\"version\":%d,\"channels\":%d,\"sample_rate\":%d,\"samples_per_pixel\":%d,\"bits\":%d,\"length\":%d,\"data\":",
+			EXPORT_VERSION, export->channels, samplerate, samples_per_pixel, export->bits, export->peaks->bins) ;
+	write_json_array (file, export, false) ;
+
+	if (with_rms)
+	{	fprintf (file, ",\"rms\":") ;
+		write_json_array (file, export, true) ;
+		} ;
+
+	fprintf (file, "}\n") ;
+} /* write_json */
+
+bool
+export_peaks (const char * path, const PEAKS * peaks, int channel, int samplerate, int samples_per_pixel, int bits, bool with_rms)
+{	EXPORT export = { peaks, channel - 1, channel < 0 ? peaks->channels : 1, bits } ;
+	const char *ext = strrchr (path, '.') ;
+	FILE *file ;
+	bool ok = true ;
+
+	if (channel < 0)
+		export.first = 0 ;
+
+	if ((file = fopen (path, "wb")) == NULL)
+		return false ;
+
+	if (ext != NULL && strcmp (ext, ".json") == 0)
+		write_json (file, &export, samplerate, samples_per_pixel, with_rms) ;
+	else
+		ok = write_dat (file, &export, samplerate, samples_per_pixel) ;
+
+	ok = ! ferror (file) && ok ;
+	ok = (fclose (file) == 0) && ok ;
+
+	return ok ;
+} /* export_peaks */
@@ -0,0 +1,40 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdbool.h>
+
+/*
+**	Waveform data export.
+**
+**	Writes the bins of a PEAKS as the binary .dat or the JSON format of
+**	BBC audiowaveform (version 2), so that a web page can draw the waveform
+**	itself. Each bin holds samples_per_pixel frames and min and max are
+**	written as 8 or 16 bit integers. The JSON also gets an "rms" array in
+**	the same layout as "data" if with_rms is set.
+**
+**	channel is as for sndfile-waveform : 0 merges all channels into one,
+**	a positive number picks that channel and a negative one writes all of
+**	them, interleaved pixel by pixel.
+**
+**	Include peaks.h first.
+*/
+
+/*
+**	Write to path, as JSON if it ends in .json and as .dat otherwise. Returns
+**	false if the file can not be written.
+*/
+bool export_peaks (const char * path, const PEAKS * peaks, int channel, int samplerate, int samples_per_pixel, int bits, bool with_rms) ;
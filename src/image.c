@@ -0,0 +1,533 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <strings.h>
+#include <pthread.h>
+
+#include <cairo.h>
+
+#ifndef HAVE_ZLIB
+#define HAVE_ZLIB 0
+#endif
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "common.h"
+#include "image.h"
+
+/* Smallest number of rows given to one PNG compression thread. */
+#define	MIN_BLOCK_ROWS		32
+
+typedef struct
+{	const unsigned char * data ;
+	int width, height, stride ;
+	/* True for CAIRO_FORMAT_ARGB32, false for CAIRO_FORMAT_RGB24. */
+	bool alpha ;
+} PIXELS ;
+
+static cairo_status_t write_png (const PIXELS * pix, FILE * file, const IMAGE_OPTIONS * options) ;
+
+int
+image_format_from_name (const char * name)
+{
+	if (strcasecmp (name, "png") == 0)
+		return IMAGE_PNG ;
+	if (strcasecmp (name, "ppm") == 0)
+		return IMAGE_PPM ;
+	if (strcasecmp (name, "pam") == 0)
+		return IMAGE_PAM ;
+	if (strcasecmp (name, "rgba") == 0 || strcasecmp (name, "raw") == 0)
+		return IMAGE_RGBA ;
+
+	return -1 ;
+} /* image_format_from_name */
+
+enum IMAGE_FORMAT
+image_format_from_path (const char * path)
+{	const char * ext ;
+	int format ;
+
+	ext = strrchr (path, '.') ;
+	if (ext == NULL || strchr (ext, '/') != NULL)
+		return IMAGE_PNG ;
+
+	format = image_format_from_name (ext + 1) ;
+
+	return format < 0 ? IMAGE_PNG : format ;
+} /* image_format_from_path */
+
+/*------------------------------------------------------------------------------
+**	Pixel conversion. Cairo stores each pixel as a native endian 32 bit word
+**	0xAARRGGBB with the colour premultiplied by alpha (the alpha byte is
+**	unused for RGB24).
+*/
+
+static inline uint32_t
+get_pixel (const unsigned char * row, int x)
+{	uint32_t pixel ;
+
+	memcpy (&pixel, row + 4 * x, sizeof (pixel)) ;
+	return pixel ;
+} /* get_pixel */
+
+static inline unsigned char
+unpremultiply (uint32_t value, uint32_t alpha)
+{
+	return (value * 255 + alpha / 2) / alpha ;
+} /* unpremultiply */
+
+/* RGB rows, colour composited onto black (ie still premultiplied). */
+static void
+convert_row_rgb (const unsigned char * src, unsigned char * dest, int width)
+{	int x ;
+
+	for (x = 0 ; x < width ; x++)
+	{	uint32_t pixel = get_pixel (src, x) ;
+
+		dest [3 * x + 0] = (pixel >> 16) & 0xff ;
+		dest [3 * x + 1] = (pixel >> 8) & 0xff ;
+		dest [3 * x + 2] = pixel & 0xff ;
+		} ;
+} /* convert_row_rgb */
+
+/* Straight (not premultiplied) RGBA rows. */
+static void
+convert_row_rgba (const unsigned char * src, unsigned char * dest, int width, bool alpha)
+{	int x ;
+
+	for (x = 0 ; x < width ; x++)
+	{	uint32_t pixel = get_pixel (src, x) ;
+		uint32_t a = alpha ? pixel >> 24 : 0xff ;
+
+		if (a == 0xff)
+		{	dest [4 * x + 0] = (pixel >> 16) & 0xff ;
+			dest [4 * x + 1] = (pixel >> 8) & 0xff ;
+			dest [4 * x + 2] = pixel & 0xff ;
+			}
+		else if (a == 0)
+			dest [4 * x + 0] = dest [4 * x + 1] = dest [4 * x + 2] = 0 ;
+		else
+		{	dest [4 * x + 0] = unpremultiply ((pixel >> 16) & 0xff, a) ;
+			dest [4 * x + 1] = unpremultiply ((pixel >> 8) & 0xff, a) ;
+			dest [4 * x + 2] = unpremultiply (pixel & 0xff, a) ;
+			} ;
+		dest [4 * x + 3] = a ;
+		} ;
+} /* convert_row_rgba */
+
+/*------------------------------------------------------------------------------
+**	Uncompressed formats.
+*/
+
+static cairo_status_t
+write_netpbm (const PIXELS * pix, FILE * file, enum IMAGE_FORMAT format)
+{	unsigned char * row ;
+	int y, depth ;
+
+	switch (format)
+	{	case IMAGE_PPM :
+			depth = 3 ;
+			fprintf (file, "P6\n%d %d\n255\n", pix->width, pix->height) ;
+			break ;
+
+		case IMAGE_PAM :
+			depth = pix->alpha ? 4 : 3 ;
+			fprintf (file, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH %d\nMAXVAL 255\nTUPLTYPE %s\nENDHDR\n",
+				pix->width, pix->height, depth, pix->alpha ? "RGB_ALPHA" : "RGB") ;
+			break ;
+
+		default :
+			/* Headerless RGBA. */
+			depth = 4 ;
+			break ;
+		} ;
+
+	if ((row = malloc (depth * pix->width)) == NULL)
+		return CAIRO_STATUS_NO_MEMORY ;
+
+	for (y = 0 ; y < pix->height ; y++)
+	{	const unsigned char * src = pix->data + (size_t) y * pix->stride ;
+
+		if (depth == 3)
+			convert_row_rgb (src, row, pix->width) ;
+		else
+			convert_row_rgba (src, row, pix->width, pix->alpha) ;
+
+		if (fwrite (row, depth, pix->width, file) != (size_t) pix->width)
+			break ;
+		} ;
+
+	free (row) ;
+
+	return y == pix->height ? CAIRO_STATUS_SUCCESS : CAIRO_STATUS_WRITE_ERROR ;
+} /* write_netpbm */
+
+static cairo_status_t
+write_stream_func (void * closure, const unsigned char * data, unsigned int length)
+{	FILE * file = closure ;
+
+	return fwrite (data, 1, length, file) == length ? CAIRO_STATUS_SUCCESS : CAIRO_STATUS_WRITE_ERROR ;
+} /* write_stream_func */
+
+void
+image_check_options (const IMAGE_OPTIONS * options)
+{
+#if HAVE_ZLIB == 0
+	if (options->compression >= 0)
+		fprintf (stderr, "Warning : built without zlib, ignoring the PNG compression level.\n") ;
+#else
+	(void) options ;
+#endif
+} /* image_check_options */
+
+cairo_status_t
+image_write (cairo_surface_t * surface, const char * path, const IMAGE_OPTIONS * options)
+{	enum IMAGE_FORMAT format ;
+	cairo_status_t status ;
+	PIXELS pix ;
+	FILE * file ;
+	bool use_stdout ;
+
+	format = options->format != IMAGE_AUTO ? options->format : image_format_from_path (path) ;
+	use_stdout = strcmp (path, "-") == 0 ;
+
+	if (format == IMAGE_PNG && (options->compression < 0 || HAVE_ZLIB == 0) && ! use_stdout)
+		return cairo_surface_write_to_png (surface, path) ;
+
+	cairo_surface_flush (surface) ;
+
+	pix.data = cairo_image_surface_get_data (surface) ;
+	pix.width = cairo_image_surface_get_width (surface) ;
+	pix.height = cairo_image_surface_get_height (surface) ;
+	pix.stride = cairo_image_surface_get_stride (surface) ;
+	pix.alpha = cairo_image_surface_get_format (surface) == CAIRO_FORMAT_ARGB32 ;
+
+	if (use_stdout)
+		file = stdout ;
+	else if ((file = fopen (path, "wb")) == NULL)
+		return CAIRO_STATUS_WRITE_ERROR ;
+
+	if (format != IMAGE_PNG)
+		status = write_netpbm (&pix, file, format) ;
+	else if (options->compression < 0 || HAVE_ZLIB == 0)
+		status = cairo_surface_write_to_png_stream (surface, write_stream_func, file) ;
+	else
+		status = write_png (&pix, file, options) ;
+
+	if (use_stdout)
+	{	if (fflush (file) != 0)
+			status = CAIRO_STATUS_WRITE_ERROR ;
+		}
+	else if (fclose (file) != 0)
+		status = CAIRO_STATUS_WRITE_ERROR ;
+
+	return status ;
+} /* image_write */
+
+/*------------------------------------------------------------------------------
+**	PNG writer.
+**
+**	The rows are split into contiguous blocks which are filtered and deflated
+**	independently, each on its own thread, the way pigz does it. Every block
+**	but the last ends with a sync flush so the raw deflate streams can simply
+**	be concatenated, and the per block Adler-32 checksums are combined into
+**	the one for the zlib stream. Each block is stored as its own IDAT chunk.
+*/
+
+#if HAVE_ZLIB
+
+typedef struct
+{	const PIXELS * pix ;
+	int level ;
+	int first_row, rows ;
+	bool last ;
+
+	unsigned char * out ;
+	size_t out_len ;
+	uLong adler ;
+	uLong raw_len ;
+	bool error ;
+} PNG_BLOCK ;
+
+typedef struct
+{	PNG_BLOCK * blocks ;
+	int block_count ;
+	int first, step ;
+} PNG_WORKER ;
+
+static void
+png_filter_row (const PIXELS * pix, int y, int level, unsigned char * prev, unsigned char * row)
+{	int k, len ;
+
+	len = (pix->alpha ? 4 : 3) * pix->width ;
+
+	if (pix->alpha)
+		convert_row_rgba (pix->data + (size_t) y * pix->stride, row + 1, pix->width, true) ;
+	else
+		convert_row_rgb (pix->data + (size_t) y * pix->stride, row + 1, pix->width) ;
+
+	/* Filter type 0 (None) is fastest, type 2 (Up) packs far better. */
+	if (level < 2 || y == 0)
+	{	row [0] = 0 ;
+		return ;
+		} ;
+
+	if (prev [0] == 0xff)
+	{	/* The previous row has not been converted in this block yet. */
+		if (pix->alpha)
+			convert_row_rgba (pix->data + (size_t) (y - 1) * pix->stride, prev + 1, pix->width, true) ;
+		else
+			convert_row_rgb (pix->data + (size_t) (y - 1) * pix->stride, prev + 1, pix->width) ;
+		} ;
+
+	/* Keep the unfiltered row for the next one. */
+	for (k = 1 ; k <= len ; k++)
+	{	unsigned char value = row [k] ;
+
+		row [k] = value - prev [k] ;
+		prev [k] = value ;
+		} ;
+
+	row [0] = 2 ;
+	prev [0] = 0 ;
+} /* png_filter_row */
+
+static void
+png_compress_block (PNG_BLOCK * block)
+{	const PIXELS * pix = block->pix ;
+	unsigned char * prev, * row ;
+	size_t row_len ;
+	z_stream strm ;
+	int y ;
+
+	row_len = 1 + (pix->alpha ? 4 : 3) * (size_t) pix->width ;
+
+	memset (&strm, 0, sizeof (strm)) ;
+	if (deflateInit2 (&strm, block->level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{	block->error = true ;
+		return ;
+		} ;
+
+	block->raw_len = row_len * block->rows ;
+	block->out_len = deflateBound (&strm, block->raw_len) + 16 ;
+	block->out = malloc (block->out_len) ;
+	prev = malloc (row_len) ;
+	row = malloc (row_len) ;
+
+	if (block->out == NULL || prev == NULL || row == NULL)
+	{	block->error = true ;
+		free (prev) ;
+		free (row) ;
+		deflateEnd (&strm) ;
+		return ;
+		} ;
+
+	/* Mark prev as not yet filled. */
+	prev [0] = 0xff ;
+
+	strm.next_out = block->out ;
+	strm.avail_out = block->out_len ;
+	block->adler = adler32 (0L, Z_NULL, 0) ;
+
+	for (y = block->first_row ; y < block->first_row + block->rows ; y++)
+	{	int flush = Z_NO_FLUSH ;
+
+		if (y == block->first_row + block->rows - 1)
+			flush = block->last ? Z_FINISH : Z_SYNC_FLUSH ;
+
+		png_filter_row (pix, y, block->level, prev, row) ;
+		block->adler = adler32 (block->adler, row, row_len) ;
+
+		strm.next_in = row ;
+		strm.avail_in = row_len ;
+		if (deflate (&strm, flush) == Z_STREAM_ERROR || strm.avail_in != 0)
+		{	block->error = true ;
+			break ;
+			} ;
+		} ;
+
+	block->out_len -= strm.avail_out ;
+
+	deflateEnd (&strm) ;
+	free (prev) ;
+	free (row) ;
+} /* png_compress_block */
+
+static void *
+png_worker (void * arg)
+{	PNG_WORKER * worker = arg ;
+	int k ;
+
+	for (k = worker->first ; k < worker->block_count ; k += worker->step)
+		png_compress_block (worker->blocks + k) ;
+
+	return NULL ;
+} /* png_worker */
+
+static void
+put_be32 (unsigned char * dest, uint32_t value)
+{	dest [0] = value >> 24 ;
+	dest [1] = value >> 16 ;
+	dest [2] = value >> 8 ;
+	dest [3] = value ;
+} /* put_be32 */
+
+static bool
+png_write_chunk (FILE * file, const char * type, const unsigned char * data, size_t len)
+{	unsigned char header [8], crc [4] ;
+	uLong sum ;
+
+	put_be32 (header, len) ;
+	memcpy (header + 4, type, 4) ;
+
+	sum = crc32 (0L, header + 4, 4) ;
+	if (len > 0)
+		sum = crc32 (sum, data, len) ;
+	put_be32 (crc, sum) ;
+
+	if (fwrite (header, 1, 8, file) != 8)
+		return false ;
+	if (len > 0 && fwrite (data, 1, len, file) != len)
+		return false ;
+
+	return fwrite (crc, 1, 4, file) == 4 ;
+} /* png_write_chunk */
+
+static cairo_status_t
+write_png (const PIXELS * pix, FILE * file, const IMAGE_OPTIONS * options)
+{	static const unsigned char signature [8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' } ;
+	unsigned char ihdr [13], zhead [2], trailer [4] ;
+	PNG_BLOCK * blocks ;
+	PNG_WORKER * workers ;
+	pthread_t * tids ;
+	cairo_status_t status = CAIRO_STATUS_SUCCESS ;
+	int k, threads, block_count, rows_per_block, level ;
+	uLong adler ;
+
+	level = MIN (options->compression, 9) ;
+	threads = MAX (options->threads, 1) ;
+
+	/* A couple of blocks per thread keeps them all busy until the end. */
+	block_count = threads == 1 ? 1 : 2 * threads ;
+	rows_per_block = (pix->height + block_count - 1) / block_count ;
+	rows_per_block = MAX (rows_per_block, MIN_BLOCK_ROWS) ;
+	block_count = (pix->height + rows_per_block - 1) / rows_per_block ;
+	threads = MIN (threads, block_count) ;
+
+	blocks = calloc (block_count, sizeof (PNG_BLOCK)) ;
+	workers = calloc (threads, sizeof (PNG_WORKER)) ;
+	tids = calloc (threads, sizeof (pthread_t)) ;
+	if (blocks == NULL || workers == NULL || tids == NULL)
+	{	free (blocks) ;
+		free (workers) ;
+		free (tids) ;
+		return CAIRO_STATUS_NO_MEMORY ;
+		} ;
+
+	for (k = 0 ; k < block_count ; k++)
+	{	blocks [k].pix = pix ;
+		blocks [k].level = level ;
+		blocks [k].first_row = k * rows_per_block ;
+		blocks [k].rows = MIN (rows_per_block, pix->height - blocks [k].first_row) ;
+		blocks [k].last = (k == block_count - 1) ;
+		} ;
+
+	for (k = 0 ; k < threads ; k++)
+	{	workers [k].blocks = blocks ;
+		workers [k].block_count = block_count ;
+		workers [k].first = k ;
+		workers [k].step = threads ;
+		} ;
+
+	/* The calling thread does the share of worker 0. */
+	for (k = 1 ; k < threads ; k++)
+		if (pthread_create (&tids [k], NULL, png_worker, &workers [k]) != 0)
+		{	/* Fall back to doing that share here. */
+			png_worker (&workers [k]) ;
+			tids [k] = 0 ;
+			} ;
+
+	png_worker (&workers [0]) ;
+
+	for (k = 1 ; k < threads ; k++)
+		if (tids [k] != 0)
+			pthread_join (tids [k], NULL) ;
+
+	for (k = 0 ; k < block_count ; k++)
+		if (blocks [k].error)
+			status = CAIRO_STATUS_NO_MEMORY ;
+
+	if (status == CAIRO_STATUS_SUCCESS)
+	{	put_be32 (ihdr, pix->width) ;
+		put_be32 (ihdr + 4, pix->height) ;
+		ihdr [8] = 8 ;						/* Bit depth. */
+		ihdr [9] = pix->alpha ? 6 : 2 ;		/* Colour type RGBA or RGB. */
+		ihdr [10] = ihdr [11] = ihdr [12] = 0 ;
+
+		/* zlib header with the FLEVEL hint matching the compression level. */
+		zhead [0] = 0x78 ;
+		zhead [1] = (level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6 ;
+		zhead [1] += 31 - (zhead [0] * 256 + zhead [1]) % 31 ;
+
+		adler = blocks [0].adler ;
+		for (k = 1 ; k < block_count ; k++)
+			adler = adler32_combine (adler, blocks [k].adler, blocks [k].raw_len) ;
+		put_be32 (trailer, adler) ;
+
+		if (fwrite (signature, 1, sizeof (signature), file) != sizeof (signature)
+				|| ! png_write_chunk (file, "IHDR", ihdr, sizeof (ihdr))
+				|| ! png_write_chunk (file, "IDAT", zhead, sizeof (zhead)))
+			status = CAIRO_STATUS_WRITE_ERROR ;
+
+		for (k = 0 ; k < block_count && status == CAIRO_STATUS_SUCCESS ; k++)
+			if (! png_write_chunk (file, "IDAT", blocks [k].out, blocks [k].out_len))
+				status = CAIRO_STATUS_WRITE_ERROR ;
+
+		if (status == CAIRO_STATUS_SUCCESS
+				&& (! png_write_chunk (file, "IDAT", trailer, sizeof (trailer))
+					|| ! png_write_chunk (file, "IEND", NULL, 0)))
+			status = CAIRO_STATUS_WRITE_ERROR ;
+		} ;
+
+	for (k = 0 ; k < block_count ; k++)
+		free (blocks [k].out) ;
+	free (blocks) ;
+	free (workers) ;
+	free (tids) ;
+
+	return status ;
+} /* write_png */
+
+#else
+
+static cairo_status_t
+write_png (const PIXELS * UNUSED (pix), FILE * UNUSED (file), const IMAGE_OPTIONS * UNUSED (options))
+{
+	/* Never called, image_write () uses Cairo's writer without zlib. */
+	return CAIRO_STATUS_WRITE_ERROR ;
+} /* write_png */
+
+#endif
@@ -0,0 +1,50 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cairo.h>
+
+/*
+**	Image output backends for the Cairo image surfaces rendered by the tools.
+**
+**	IMAGE_AUTO picks the format from the file name extension (.png, .ppm,
+**	.pam, .rgba or .raw) and falls back to PNG. The file name "-" writes to
+**	stdout.
+*/
+
+enum IMAGE_FORMAT { IMAGE_AUTO = 0, IMAGE_PNG, IMAGE_PPM, IMAGE_PAM, IMAGE_RGBA } ;
+
+typedef struct
+{	enum IMAGE_FORMAT format ;
+	/* PNG deflate level 0 (store only) to 9, or -1 for Cairo's own writer. */
+	int compression ;
+	/* Number of threads compressing PNG row blocks in parallel. */
+	int threads ;
+} IMAGE_OPTIONS ;
+
+/* Parse "png", "ppm", "pam", "rgba" or "raw". Returns -1 if unknown. */
+int image_format_from_name (const char * name) ;
+
+enum IMAGE_FORMAT image_format_from_path (const char * path) ;
+
+/* Warn on stderr about options this build can not honour. Call it once after parsing. */
+void image_check_options (const IMAGE_OPTIONS * options) ;
+
+/*
+**	Write the surface to path. The surface data is read in place, one row
+**	at a time, so no copy of the whole image is ever made.
+*/
+cairo_status_t image_write (cairo_surface_t * surface, const char * path, const IMAGE_OPTIONS * options) ;
@@ -0,0 +1,518 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "common.h"
+#include "loudness.h"
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__SSE2__)
+#define	HAVE_SSE2_KERNEL	1
+#include <emmintrin.h>
+#endif
+
+/* Blocks a second, of 100 ms each. */
+#define	BLOCK_RATE			10
+
+/* Blocks in the momentary and the short-term windows. */
+#define	MOMENTARY_BLOCKS	4
+#define	SHORT_TERM_BLOCKS	30
+
+/* The gates of the integrated loudness and of the loudness range, in LUFS and LU. */
+#define	ABSOLUTE_GATE		(-70.0)
+#define	RELATIVE_GATE		(-10.0)
+#define	RANGE_GATE			(-20.0)
+
+/* Phases of the true peak filter, and taps of each. */
+#define	PEAK_PHASES			4
+#define	PEAK_TAPS			12
+
+/* Frames of a channel oversampled at a time. */
+#define	PEAK_RUN			256
+
+/* Filter states smaller than this are flushed, rather than decaying into denormals. */
+#define	STATE_FLUSH			(1e-30)
+
+/* The four times oversampling filter of BS.1770-4, annex 2, one row a phase. */
+static const float peak_filter [PEAK_PHASES][PEAK_TAPS] =
+{	{	0.0017089843750, 0.0109863281250, -0.0196533203125, 0.0332031250000,
+		-0.0594482421875, 0.1373291015625, 0.9721679687500, -0.1022949218750,
+		0.0476074218750, -0.0266113281250, 0.0148925781250, -0.0083007812500
+		},
+	{	-0.0291748046875, 0.0292968750000, -0.0517578125000, 0.0891113281250,
+		-0.1665039062500, 0.4650878906250, 0.7797851562500, -0.2003173828125,
+		0.1015625000000, -0.0582275390625, 0.0330810546875, -0.0189208984375
+		},
+	{	-0.0189208984375, 0.0330810546875, -0.0582275390625, 0.1015625000000,
+		-0.2003173828125, 0.7797851562500, 0.4650878906250, -0.1665039062500,
+		0.0891113281250, -0.0517578125000, 0.0292968750000, -0.0291748046875
+		},
+	{	-0.0083007812500, 0.0148925781250, -0.0266113281250, 0.0476074218750,
+		-0.1022949218750, 0.9721679687500, 0.1373291015625, -0.0594482421875,
+		0.0332031250000, -0.0196533203125, 0.0109863281250, 0.0017089843750
+		}
+	} ;
+
+/*
+**	The K weighting filters at samplerate, a high shelf of about +4 dB and
+**	a high pass, from the analogue prototypes of the 48 kHz coefficients
+**	BS.1770 gives.
+*/
+static void
+k_weighting (double coeff [2][5], int samplerate)
+{	const double shelf_q = 0.7071752369554196, pass_q = 0.5003270373238773 ;
+	double K, Vh, Vb, a0 ;
+
+	K = tan (M_PI * 1681.974450955533 / samplerate) ;
+	Vh = pow (10.0, 3.999843853973347 / 20.0) ;
+	Vb = pow (Vh, 0.4996667741545416) ;
+	a0 = 1.0 + K / shelf_q + K * K ;
+
+	coeff [0][0] = (Vh + Vb * K / shelf_q + K * K) / a0 ;
+	coeff [0][1] = 2.0 * (K * K - Vh) / a0 ;
+	coeff [0][2] = (Vh - Vb * K / shelf_q + K * K) / a0 ;
+	coeff [0][3] = 2.0 * (K * K - 1.0) / a0 ;
+	coeff [0][4] = (1.0 - K / shelf_q + K * K) / a0 ;
+
+	K = tan (M_PI * 38.13547087602444 / samplerate) ;
+	a0 = 1.0 + K / pass_q + K * K ;
+
+	coeff [1][0] = 1.0 ;
+	coeff [1][1] = -2.0 ;
+	coeff [1][2] = 1.0 ;
+	coeff [1][3] = 2.0 * (K * K - 1.0) / a0 ;
+	coeff [1][4] = (1.0 - K / pass_q + K * K) / a0 ;
+} /* k_weighting */
+
+LOUDNESS *
+loudness_create (int channels, int samplerate, sf_count_t origin)
+{	LOUDNESS *loudness ;
+	int ch ;
+
+	if ((loudness = calloc (1, sizeof (LOUDNESS))) == NULL
+			|| (loudness->state = calloc (4 * channels, sizeof (double))) == NULL
+			|| (loudness->weight = calloc (channels, sizeof (float))) == NULL
+			|| (loudness->history = calloc ((PEAK_TAPS - 1) * channels, sizeof (float))) == NULL
+			|| (loudness->true_peak = calloc (channels, sizeof (float))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	loudness->channels = channels ;
+	loudness->samplerate = samplerate ;
+	loudness->origin = origin ;
+	loudness->start = origin ;
+	k_weighting (loudness->coeff, samplerate) ;
+
+	for (ch = 0 ; ch < channels ; ch++)
+		loudness->weight [ch] = 1.0 ;
+
+	/* L R C Ls Rs and L R C LFE Ls Rs. */
+	if (channels == 5)
+		loudness->weight [3] = loudness->weight [4] = 1.41 ;
+	else if (channels == 6)
+	{	loudness->weight [3] = 0.0 ;
+		loudness->weight [4] = loudness->weight [5] = 1.41 ;
+		} ;
+
+	return loudness ;
+} /* loudness_create */
+
+void
+loudness_destroy (LOUDNESS * loudness)
+{
+	free (loudness->state) ;
+	free (loudness->weight) ;
+	free (loudness->history) ;
+	free (loudness->true_peak) ;
+	free (loudness->block) ;
+	free (loudness) ;
+} /* loudness_destroy */
+
+/* The block holding frame pos, which must not be before the origin. */
+static sf_count_t
+block_index (const LOUDNESS * loudness, sf_count_t pos)
+{
+	return ((pos - loudness->origin) * BLOCK_RATE) / loudness->samplerate ;
+} /* block_index */
+
+/* First frame of block b. */
+static sf_count_t
+block_edge (const LOUDNESS * loudness, sf_count_t b)
+{
+	return loudness->origin + (b * loudness->samplerate + BLOCK_RATE - 1) / BLOCK_RATE ;
+} /* block_edge */
+
+LOUDNESS *
+loudness_part (const LOUDNESS * whole, sf_count_t start)
+{	LOUDNESS *part ;
+
+	part = loudness_create (whole->channels, whole->samplerate, whole->origin) ;
+	part->start = MAX (start, whole->origin) ;
+	part->first_block = block_index (part, part->start) ;
+
+	return part ;
+} /* loudness_part */
+
+sf_count_t
+loudness_preroll (const LOUDNESS * loudness)
+{	/* The high pass, the slower of the two filters, decays by e ^ -24 in 100 ms. */
+	return loudness->samplerate / BLOCK_RATE ;
+} /* loudness_preroll */
+
+/* Block b, making room for it if need be. */
+static LOUDNESS_BLOCK *
+get_block (LOUDNESS * loudness, sf_count_t b)
+{	int k = (int) (b - loudness->first_block) ;
+
+	if (k >= loudness->max_blocks)
+	{	int max_blocks = MAX (2 * loudness->max_blocks, MAX (k + 1, 64)) ;
+		LOUDNESS_BLOCK *block ;
+
+		if ((block = realloc (loudness->block, max_blocks * sizeof (LOUDNESS_BLOCK))) == NULL)
+		{	printf ("%s : Not enough memory.\n", __func__) ;
+			exit (1) ;
+			} ;
+
+		memset (block + loudness->max_blocks, 0, (max_blocks - loudness->max_blocks) * sizeof (LOUDNESS_BLOCK)) ;
+		loudness->block = block ;
+		loudness->max_blocks = max_blocks ;
+		} ;
+
+	loudness->blocks = MAX (loudness->blocks, k + 1) ;
+	return loudness->block + k ;
+} /* get_block */
+
+/* K weight count frames, returning the sum of the weighted squares. */
+static double
+filter_frames (LOUDNESS * loudness, const float * data, int count)
+{	const double *shelf = loudness->coeff [0], *pass = loudness->coeff [1] ;
+	int channels = loudness->channels, ch, k ;
+	double total = 0.0 ;
+
+	for (ch = 0 ; ch < channels ; ch++)
+	{	double *state = loudness->state + 4 * ch ;
+		double s1 = state [0], s2 = state [1], p1 = state [2], p2 = state [3] ;
+		double sumsq = 0.0 ;
+
+		if (loudness->weight [ch] == 0.0)
+			continue ;
+
+		/* Transposed direct form II, the shelf and then the high pass. */
+		for (k = 0 ; k < count ; k++)
+		{	double x = data [k * channels + ch], y ;
+
+			y = shelf [0] * x + s1 ;
+			s1 = shelf [1] * x - shelf [3] * y + s2 ;
+			s2 = shelf [2] * x - shelf [4] * y ;
+
+			x = y ;
+			y = pass [0] * x + p1 ;
+			p1 = pass [1] * x - pass [3] * y + p2 ;
+			p2 = pass [2] * x - pass [4] * y ;
+
+			sumsq += y * y ;
+			} ;
+
+		state [0] = fabs (s1) < STATE_FLUSH ? 0.0 : s1 ;
+		state [1] = fabs (s2) < STATE_FLUSH ? 0.0 : s2 ;
+		state [2] = fabs (p1) < STATE_FLUSH ? 0.0 : p1 ;
+		state [3] = fabs (p2) < STATE_FLUSH ? 0.0 : p2 ;
+
+		total += loudness->weight [ch] * sumsq ;
+		} ;
+
+	return total ;
+} /* filter_frames */
+
+/* The most the true peak filter can raise the highest of its taps by. */
+static float
+peak_gain (void)
+{	float gain = 0.0 ;
+	int p, j ;
+
+	for (p = 0 ; p < PEAK_PHASES ; p++)
+	{	float sum = 0.0 ;
+
+		for (j = 0 ; j < PEAK_TAPS ; j++)
+			sum += fabsf (peak_filter [p][j]) ;
+		gain = MAX (gain, sum) ;
+		} ;
+
+	return gain ;
+} /* peak_gain */
+
+/*
+**	The highest of peak and the four phases of the oversampled signal at
+**	count frames, each of which is the last of PEAK_TAPS from x on.
+*/
+#if HAVE_SSE2_KERNEL
+
+static float
+peak_kernel (const float * x, int count, float peak)
+{	__m128 coeff [PEAK_TAPS], top, y, z ;
+	const __m128 abs_mask = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff)) ;
+	int k, j ;
+
+	/* All four phases of one frame in one vector. */
+	for (j = 0 ; j < PEAK_TAPS ; j++)
+		coeff [j] = _mm_setr_ps (peak_filter [0][j], peak_filter [1][j], peak_filter [2][j], peak_filter [3][j]) ;
+
+	/* Two sums of alternate taps, so the adds of each are not all waiting on each other. */
+	top = _mm_set1_ps (peak) ;
+	for (k = 0 ; k < count ; k++)
+	{	y = _mm_mul_ps (coeff [0], _mm_set1_ps (x [k])) ;
+		z = _mm_mul_ps (coeff [1], _mm_set1_ps (x [k + 1])) ;
+		for (j = 2 ; j < PEAK_TAPS ; j += 2)
+		{	y = _mm_add_ps (y, _mm_mul_ps (coeff [j], _mm_set1_ps (x [k + j]))) ;
+			z = _mm_add_ps (z, _mm_mul_ps (coeff [j + 1], _mm_set1_ps (x [k + j + 1]))) ;
+			} ;
+		top = _mm_max_ps (top, _mm_and_ps (_mm_add_ps (y, z), abs_mask)) ;
+		} ;
+
+	top = _mm_max_ps (top, _mm_movehl_ps (top, top)) ;
+	top = _mm_max_ss (top, _mm_shuffle_ps (top, top, 1)) ;
+	return _mm_cvtss_f32 (top) ;
+} /* peak_kernel */
+
+#else
+
+static float
+peak_kernel (const float * x, int count, float peak)
+{	int k, p, j ;
+
+	for (k = 0 ; k < count ; k++)
+		for (p = 0 ; p < PEAK_PHASES ; p++)
+		{	float y = 0.0 ;
+
+			for (j = 0 ; j < PEAK_TAPS ; j++)
+				y += peak_filter [p][j] * x [k + j] ;
+			peak = MAX (peak, fabsf (y)) ;
+			} ;
+
+	return peak ;
+} /* peak_kernel */
+
+#endif
+
+/*
+**	Oversample count frames, keeping the highest peak of each channel if
+**	measure is true. Runs whose highest sample, with the taps from before
+**	them, times peak_gain () is no higher than the peak so far cannot raise
+**	it, and are only kept for the taps of the next.
+*/
+static void
+peak_frames (LOUDNESS * loudness, const float * data, int count, bool measure)
+{	float x [PEAK_TAPS - 1 + PEAK_RUN], gain = peak_gain () ;
+	int channels = loudness->channels, ch, k, j, run ;
+
+	for (ch = 0 ; ch < channels ; ch++)
+	{	float *history = loudness->history + (PEAK_TAPS - 1) * ch ;
+		float peak = loudness->true_peak [ch] ;
+
+		memcpy (x, history, (PEAK_TAPS - 1) * sizeof (float)) ;
+
+		for (k = 0 ; k < count ; k += run)
+		{	float top = 0.0, sample = 0.0 ;
+
+			run = MIN (PEAK_RUN, count - k) ;
+			for (j = 0 ; j < run ; j++)
+			{	x [PEAK_TAPS - 1 + j] = data [(k + j) * channels + ch] ;
+				sample = MAX (sample, fabsf (x [PEAK_TAPS - 1 + j])) ;
+				} ;
+
+			if (measure)
+			{	for (j = 0 ; j < PEAK_TAPS - 1 ; j++)
+					top = MAX (top, fabsf (x [j])) ;
+
+				peak = MAX (peak, sample) ;
+				if (MAX (top, sample) * gain > peak)
+					peak = peak_kernel (x, run, peak) ;
+				} ;
+
+			memmove (x, x + run, (PEAK_TAPS - 1) * sizeof (float)) ;
+			} ;
+
+		memcpy (history, x, (PEAK_TAPS - 1) * sizeof (float)) ;
+		loudness->true_peak [ch] = peak ;
+		} ;
+} /* peak_frames */
+
+void
+loudness_add (LOUDNESS * loudness, sf_count_t pos, const float * data, int count)
+{	int channels = loudness->channels, prime = 0, k ;
+
+	/* Frames before the start only go through the filters. */
+	if (pos < loudness->start)
+	{	prime = (int) MIN (count, loudness->start - pos) ;
+		filter_frames (loudness, data, prime) ;
+		peak_frames (loudness, data, prime, false) ;
+		} ;
+
+	for (k = prime ; k < count ; )
+	{	sf_count_t b = block_index (loudness, pos + k) ;
+		int end = (int) MIN (count, block_edge (loudness, b + 1) - pos) ;
+		LOUDNESS_BLOCK *block = get_block (loudness, b) ;
+
+		block->sumsq += filter_frames (loudness, data + k * channels, end - k) ;
+		block->count += end - k ;
+		k = end ;
+		} ;
+
+	peak_frames (loudness, data + prime * channels, count - prime, true) ;
+} /* loudness_add */
+
+void
+loudness_merge (LOUDNESS * whole, const LOUDNESS * part)
+{	int k, ch ;
+
+	for (k = 0 ; k < part->blocks ; k++)
+	{	LOUDNESS_BLOCK *block = get_block (whole, part->first_block + k) ;
+
+		block->sumsq += part->block [k].sumsq ;
+		block->count += part->block [k].count ;
+		} ;
+
+	for (ch = 0 ; ch < whole->channels ; ch++)
+		whole->true_peak [ch] = MAX (whole->true_peak [ch], part->true_peak [ch]) ;
+} /* loudness_merge */
+
+/* The loudness of a mean square, -HUGE_VAL for silence. */
+static double
+lufs (double mean)
+{
+	return mean > 0.0 ? -0.691 + 10.0 * log10 (mean) : -HUGE_VAL ;
+} /* lufs */
+
+/* Mean squares of the size blocks ending at each block from the first whole window on. */
+static int
+window_means (const LOUDNESS * loudness, int size, double * mean)
+{	int blocks = loudness->blocks, k, j, n = 0 ;
+
+	/* Leave out a last block which is short. */
+	if (blocks > 0 && loudness->block [blocks - 1].count < block_edge (loudness, loudness->first_block + blocks)
+				- block_edge (loudness, loudness->first_block + blocks - 1))
+		blocks -- ;
+
+	for (k = size - 1 ; k < blocks ; k++)
+	{	double sumsq = 0.0 ;
+		sf_count_t count = 0 ;
+
+		for (j = k - size + 1 ; j <= k ; j++)
+		{	sumsq += loudness->block [j].sumsq ;
+			count += loudness->block [j].count ;
+			} ;
+
+		mean [n++] = count > 0 ? sumsq / count : 0.0 ;
+		} ;
+
+	return n ;
+} /* window_means */
+
+/* The loudness of the mean of the means above gate LUFS. */
+static double
+gated_loudness (const double * mean, int n, double gate)
+{	double threshold = pow (10.0, (gate + 0.691) / 10.0), sum = 0.0 ;
+	int k, count = 0 ;
+
+	for (k = 0 ; k < n ; k++)
+		if (mean [k] > threshold)
+		{	sum += mean [k] ;
+			count ++ ;
+			} ;
+
+	return count > 0 ? lufs (sum / count) : -HUGE_VAL ;
+} /* gated_loudness */
+
+static int
+compare_double (const void * a, const void * b)
+{	double x = * (const double *) a, y = * (const double *) b ;
+
+	return (x > y) - (x < y) ;
+} /* compare_double */
+
+/* EBU Tech 3342 : the spread from the 10th to the 95th percentile of the gated short-term loudness. */
+static double
+loudness_range (double * mean, int n)
+{	double gate, threshold ;
+	int k, count = 0 ;
+
+	gate = MAX (ABSOLUTE_GATE, gated_loudness (mean, n, ABSOLUTE_GATE) + RANGE_GATE) ;
+	threshold = pow (10.0, (gate + 0.691) / 10.0) ;
+
+	for (k = 0 ; k < n ; k++)
+		if (mean [k] > threshold)
+			mean [count++] = mean [k] ;
+
+	if (count == 0)
+		return 0.0 ;
+
+	qsort (mean, count, sizeof (double), compare_double) ;
+	return lufs (mean [lrint (0.95 * (count - 1))]) - lufs (mean [lrint (0.10 * (count - 1))]) ;
+} /* loudness_range */
+
+void
+loudness_result (const LOUDNESS * loudness, LOUDNESS_RESULT * result)
+{	double *mean, peak = 0.0 ;
+	int k, n ;
+
+	if ((mean = malloc (MAX (loudness->blocks, 1) * sizeof (double))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	result->momentary_max = -HUGE_VAL ;
+	n = window_means (loudness, MOMENTARY_BLOCKS, mean) ;
+	for (k = 0 ; k < n ; k++)
+		result->momentary_max = MAX (result->momentary_max, lufs (mean [k])) ;
+
+	/* The relative gate is 10 LU under the loudness of the blocks over the absolute one. */
+	result->integrated = gated_loudness (mean, n,
+				MAX (ABSOLUTE_GATE, gated_loudness (mean, n, ABSOLUTE_GATE) + RELATIVE_GATE)) ;
+
+	result->short_term_max = -HUGE_VAL ;
+	n = window_means (loudness, SHORT_TERM_BLOCKS, mean) ;
+	for (k = 0 ; k < n ; k++)
+		result->short_term_max = MAX (result->short_term_max, lufs (mean [k])) ;
+
+	result->range = loudness_range (mean, n) ;
+
+	for (k = 0 ; k < loudness->channels ; k++)
+		peak = MAX (peak, loudness->true_peak [k]) ;
+	result->true_peak = peak > 0.0 ? 20.0 * log10 (peak) : -HUGE_VAL ;
+
+	free (mean) ;
+} /* loudness_result */
+
+double
+loudness_short_term (const LOUDNESS * loudness, sf_count_t pos)
+{	sf_count_t last, k, count = 0 ;
+	double sumsq = 0.0 ;
+
+	last = MIN (block_index (loudness, pos) - loudness->first_block, loudness->blocks - 1) ;
+
+	for (k = MAX (0, last - SHORT_TERM_BLOCKS + 1) ; k <= last ; k++)
+	{	sumsq += loudness->block [k].sumsq ;
+		count += loudness->block [k].count ;
+		} ;
+
+	return count > 0 ? lufs (sumsq / count) : -HUGE_VAL ;
+} /* loudness_short_term */
@@ -0,0 +1,85 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sndfile.h>
+
+/*
+**	EBU R128 loudness and true peak, as ITU-R BS.1770-4 measures them.
+**
+**	Each channel is K weighted and the weighted squares of all the channels
+**	are summed in blocks of 100 ms from frame origin. The loudness of a
+**	window is -0.691 + 10 * log10 (mean square) in LUFS, over 4 blocks for
+**	the momentary loudness and 30 for the short-term. Channels 4 and 5 of
+**	five, and 5 and 6 of six, are the surrounds and weigh 1.41, and channel
+**	4 of six is the LFE and is left out.
+**
+**	The true peak is the highest sample of the signal oversampled four
+**	times with the 48 tap filter of BS.1770-4, or of the signal itself.
+**
+**	A file may be measured in parts, each from its own frame on, which are
+**	merged into the whole once they are done.
+*/
+
+/* The K weighted squares of one block, summed over the channels. */
+typedef struct
+{	double sumsq ;
+	int count ;
+} LOUDNESS_BLOCK ;
+
+typedef struct
+{	int channels, samplerate ;
+	sf_count_t origin ;		/* First frame of block 0. */
+	sf_count_t start ;		/* Frames before this only go through the filters. */
+	double coeff [2][5] ;	/* b0, b1, b2, a1, a2 of the shelf and the high pass. */
+	double *state ;			/* Four per channel, two for each filter. */
+	float *weight ;
+	float *history ;		/* The last frames of each channel, for the true peak filter. */
+	float *true_peak ;		/* Of each channel. */
+	sf_count_t first_block ;
+	int blocks, max_blocks ;
+	LOUDNESS_BLOCK *block ;	/* Block first_block + k is block [k]. */
+} LOUDNESS ;
+
+/* The figures EBU R128 asks for, -HUGE_VAL for silence or too little audio. */
+typedef struct
+{	double integrated ;		/* LUFS */
+	double range ;			/* LU, of the short-term loudness. */
+	double momentary_max ;	/* LUFS */
+	double short_term_max ;	/* LUFS */
+	double true_peak ;		/* dBTP, the highest of any channel. */
+} LOUDNESS_RESULT ;
+
+LOUDNESS * loudness_create (int channels, int samplerate, sf_count_t origin) ;
+
+/* A part of the measure of whole, from frame start on. */
+LOUDNESS * loudness_part (const LOUDNESS * whole, sf_count_t start) ;
+
+void loudness_destroy (LOUDNESS * loudness) ;
+
+/* Frames to add before the start so the filters have settled. */
+sf_count_t loudness_preroll (const LOUDNESS * loudness) ;
+
+/* Add count interleaved frames from frame pos, which may be before the start. */
+void loudness_add (LOUDNESS * loudness, sf_count_t pos, const float * data, int count) ;
+
+/* Add the blocks and true peaks of part into whole. */
+void loudness_merge (LOUDNESS * whole, const LOUDNESS * part) ;
+
+void loudness_result (const LOUDNESS * loudness, LOUDNESS_RESULT * result) ;
+
+/* The short-term loudness, in LUFS, up to the end of the block holding frame pos. */
+double loudness_short_term (const LOUDNESS * loudness, sf_count_t pos) ;
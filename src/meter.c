@@ -0,0 +1,82 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <pthread.h>
+
+#include "meter.h"
+
+/* Bits of the mantissa that index the table. */
+#define	METER_TABLE_BITS	8
+#define	METER_TABLE_SIZE	(1 << METER_TABLE_BITS)
+
+/* The meter range in dB and how sharply it bends, copied from ardour3. */
+#define	METER_LOWER_DB		(-192.0)
+#define	METER_NON_LINEARITY	(8.0)
+
+/*
+**	The deflection is t ^ 8 with t = 1 + ln (c) * 20 / (192 * ln (10)). With
+**	c = m * 2 ^ e for m in [0.5, 1), ln (c) = ln (m) + e * ln (2), and entry
+**	k of the table is ln (m) at m = 0.5 + k / (2 * METER_TABLE_SIZE).
+*/
+static float log_table [METER_TABLE_SIZE + 1] ;
+static pthread_once_t log_table_once = PTHREAD_ONCE_INIT ;
+
+static void
+fill_log_table (void)
+{	int k ;
+
+	for (k = 0 ; k <= METER_TABLE_SIZE ; k++)
+		log_table [k] = log (0.5 + 0.5 * k / METER_TABLE_SIZE) ;
+} /* fill_log_table */
+
+float
+meter_deflection (float coeff)
+{	const float scale = 20.0 / (-METER_LOWER_DB * M_LN10) ;
+	float mantissa, pos, t ;
+	int e, k ;
+
+	/* Also 0.0 for a coefficient of 0.0 or a NaN. */
+	if (! (coeff > 0.0f))
+		return 0.0 ;
+
+	/* Images may be drawn on several threads at once. */
+	pthread_once (&log_table_once, fill_log_table) ;
+
+	mantissa = frexpf (coeff, &e) ;
+	pos = (mantissa - 0.5f) * (2 * METER_TABLE_SIZE) ;
+	k = (int) pos ;
+	k = k < METER_TABLE_SIZE ? k : METER_TABLE_SIZE - 1 ;
+
+	t = log_table [k] + (pos - k) * (log_table [k + 1] - log_table [k]) ;
+	t = 1.0f + scale * (t + e * (float) M_LN2) ;
+	if (t <= 0.0f)
+		return 0.0 ;
+
+	t *= t ;
+	t *= t ;
+	return t * t ;
+} /* meter_deflection */
+
+double
+meter_coefficient (double deflection)
+{
+	if (deflection <= 0.0)
+		return 0.0 ;
+
+	return pow (10.0, METER_LOWER_DB * (1.0 - pow (deflection, 1.0 / METER_NON_LINEARITY)) / 20.0) ;
+} /* meter_coefficient */
@@ -0,0 +1,34 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+**	The log meter scale of sndfile-waveform -l, from ardour : a coefficient
+**	c maps to ((20 * log10 (c) + 192) / 192) ^ 8, which is 0.0 at -192 dB
+**	and 1.0 at 0 dB.
+**
+**	meter_deflection () works this out from a table of the log of the
+**	mantissa of c, interpolated, and three squarings. It rises with c like
+**	the curve does and is within METER_MAX_ERROR of it for c up to 1.0,
+**	which tests/meter_test checks.
+*/
+
+#define	METER_MAX_ERROR		(2e-6)
+
+float meter_deflection (float coeff) ;
+
+/* The coefficient whose deflection is deflection, the exact inverse. */
+double meter_coefficient (double deflection) ;
@@ -0,0 +1,255 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "peaks.h"
+#include "overview.h"
+
+#define	OVERVIEW_VERSION	1
+
+/* Frames read at a time when building an overview. */
+#define	READ_FRAMES			16384
+
+typedef struct
+{	char magic [4] ;
+	int32_t version, channels, block, levels, pad ;
+	int64_t frames, source_size, source_mtime ;
+} OV_HEADER ;
+
+typedef struct
+{	float min, max ;
+	double sumsq ;
+} OV_BLOCK ;
+
+static sf_count_t
+level_blocks (sf_count_t frames, int level)
+{	sf_count_t len = (sf_count_t) OVERVIEW_BLOCK << level ;
+
+	return (frames + len - 1) / len ;
+} /* level_blocks */
+
+static bool
+source_stat (const char * sndfilepath, int64_t * size, int64_t * mtime)
+{	struct stat st ;
+
+	if (stat (sndfilepath, &st) != 0)
+		return false ;
+
+	*size = st.st_size ;
+	*mtime = st.st_mtime ;
+	return true ;
+} /* source_stat */
+
+static bool
+read_header (FILE * file, OV_HEADER * header)
+{
+	if (fread (header, sizeof (OV_HEADER), 1, file) != 1)
+		return false ;
+
+	return memcmp (header->magic, "SFOV", 4) == 0 && header->version == OVERVIEW_VERSION
+			&& header->block == OVERVIEW_BLOCK && header->channels > 0 && header->levels > 0 ;
+} /* read_header */
+
+bool
+overview_valid (const char * path, const char * sndfilepath)
+{	OV_HEADER header ;
+	int64_t size, mtime ;
+	FILE *file ;
+	bool valid ;
+
+	if (! source_stat (sndfilepath, &size, &mtime) || (file = fopen (path, "rb")) == NULL)
+		return false ;
+
+	valid = read_header (file, &header) && header.source_size == size && header.source_mtime == mtime ;
+
+	fclose (file) ;
+	return valid ;
+} /* overview_valid */
+
+static void
+merge_block (OV_BLOCK * dest, const OV_BLOCK * src)
+{
+	dest->min = MIN (dest->min, src->min) ;
+	dest->max = MAX (dest->max, src->max) ;
+	dest->sumsq += src->sumsq ;
+} /* merge_block */
+
+bool
+overview_create (const char * path, const char * sndfilepath, SNDFILE * infile, const SF_INFO * info)
+{	OV_HEADER header = { "SFOV", OVERVIEW_VERSION, 0, OVERVIEW_BLOCK, 0, 0, 0, 0, 0 } ;
+	OV_BLOCK **level ;
+	double *data ;
+	char tmppath [1024] ;
+	FILE *file ;
+	sf_count_t pos = 0, count, k ;
+	int channels = info->channels, ch, l ;
+	bool ok = true ;
+
+	header.channels = channels ;
+	header.frames = info->frames ;
+	if (! source_stat (sndfilepath, &header.source_size, &header.source_mtime))
+		return false ;
+
+	header.levels = 1 ;
+	while (level_blocks (info->frames, header.levels - 1) > 1)
+		header.levels ++ ;
+
+	if ((level = calloc (header.levels, sizeof (OV_BLOCK *))) == NULL
+			|| (data = malloc (READ_FRAMES * channels * sizeof (double))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	for (l = 0 ; l < header.levels ; l++)
+	{	sf_count_t blocks = level_blocks (info->frames, l) ;
+
+		if ((level [l] = malloc (MAX (blocks, 1) * channels * sizeof (OV_BLOCK))) == NULL)
+		{	printf ("%s : Not enough memory.\n", __func__) ;
+			exit (1) ;
+			} ;
+
+		for (k = 0 ; k < blocks * channels ; k++)
+		{	level [l][k].min = 1.0 ;
+			level [l][k].max = -1.0 ;
+			level [l][k].sumsq = 0.0 ;
+			} ;
+		} ;
+
+	/* The finest level comes from the audio ... */
+	sf_seek (infile, 0, SEEK_SET) ;
+	while (pos < info->frames && (count = sf_readf_double (infile, data, READ_FRAMES)) > 0)
+	{	count = MIN (count, info->frames - pos) ;
+
+		for (k = 0 ; k < count ; k++)
+		{	OV_BLOCK *block = level [0] + ((pos + k) / OVERVIEW_BLOCK) * channels ;
+
+			for (ch = 0 ; ch < channels ; ch++)
+			{	double value = data [k * channels + ch] ;
+
+				block [ch].min = MIN (block [ch].min, value) ;
+				block [ch].max = MAX (block [ch].max, value) ;
+				block [ch].sumsq += value * value ;
+				} ;
+			} ;
+
+		pos += count ;
+		} ;
+
+	/* ... and each of the others from pairs of blocks of the one before. */
+	for (l = 1 ; l < header.levels ; l++)
+	{	sf_count_t prev_blocks = level_blocks (info->frames, l - 1) ;
+
+		for (k = 0 ; k < prev_blocks * channels ; k++)
+			merge_block (level [l] + (k / (2 * channels)) * channels + k % channels, level [l - 1] + k) ;
+		} ;
+
+	snprintf (tmppath, sizeof (tmppath), "%s.tmp", path) ;
+
+	if ((file = fopen (tmppath, "wb")) == NULL)
+		ok = false ;
+	else
+	{	ok = fwrite (&header, sizeof (header), 1, file) == 1 ;
+
+		for (l = 0 ; ok && l < header.levels ; l++)
+		{	size_t len = level_blocks (info->frames, l) * channels ;
+
+			ok = fwrite (level [l], sizeof (OV_BLOCK), len, file) == len ;
+			} ;
+
+		ok = (fclose (file) == 0) && ok ;
+		ok = ok && rename (tmppath, path) == 0 ;
+		if (! ok)
+			remove (tmppath) ;
+		} ;
+
+	if (! ok)
+		fprintf (stderr, "Warning : could not write overview file '%s'.\n", path) ;
+
+	for (l = 0 ; l < header.levels ; l++)
+		free (level [l]) ;
+	free (level) ;
+	free (data) ;
+
+	return ok ;
+} /* overview_create */
+
+bool
+overview_read_peaks (const char * path, PEAKS * peaks)
+{	OV_HEADER header ;
+	OV_BLOCK *blocks ;
+	FILE *file ;
+	sf_count_t count, k ;
+	off_t offset ;
+	int l, ch ;
+
+	if ((file = fopen (path, "rb")) == NULL)
+		return false ;
+
+	if (! read_header (file, &header) || header.channels != peaks->channels
+			|| header.frames != peaks->frames || header.frames / peaks->bins < OVERVIEW_BLOCK)
+	{	fclose (file) ;
+		return false ;
+		} ;
+
+	/* The coarsest level with at least one block per bin. */
+	offset = sizeof (header) ;
+	for (l = 0 ; l + 1 < header.levels && ((sf_count_t) OVERVIEW_BLOCK << (l + 1)) <= header.frames / peaks->bins ; l++)
+		offset += (off_t) (level_blocks (header.frames, l) * header.channels * sizeof (OV_BLOCK)) ;
+
+	count = level_blocks (header.frames, l) ;
+	if ((blocks = malloc (count * header.channels * sizeof (OV_BLOCK))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	if (fseeko (file, offset, SEEK_SET) != 0
+			|| fread (blocks, sizeof (OV_BLOCK), count * header.channels, file) != (size_t) (count * header.channels))
+	{	free (blocks) ;
+		fclose (file) ;
+		return false ;
+		} ;
+
+	fclose (file) ;
+
+	for (k = 0 ; k < count ; k++)
+	{	sf_count_t start = k * ((sf_count_t) OVERVIEW_BLOCK << l) ;
+		sf_count_t len = MIN ((sf_count_t) OVERVIEW_BLOCK << l, header.frames - start) ;
+		int bin = peaks_bin (peaks, start) ;
+
+		for (ch = 0 ; ch < header.channels ; ch++)
+		{	PEAK_BIN *dest = peaks->bin + ch * peaks->bins + bin ;
+			const OV_BLOCK *src = blocks + k * header.channels + ch ;
+
+			dest->min = MIN (dest->min, src->min) ;
+			dest->max = MAX (dest->max, src->max) ;
+			dest->sumsq += src->sumsq ;
+			dest->count += len ;
+			} ;
+		} ;
+
+	free (blocks) ;
+	return true ;
+} /* overview_read_peaks */
@@ -0,0 +1,56 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdbool.h>
+
+#include <sndfile.h>
+
+/*
+**	Peak overview files.
+**
+**	An overview is a sidecar file holding the min, max and sum of squares of
+**	every channel of a sound file in blocks of OVERVIEW_BLOCK frames, then
+**	of twice that, four times that and so on up to a single block. Any
+**	waveform at least OVERVIEW_BLOCK frames per pixel wide can be binned
+**	from the closest level without decoding the audio again.
+**
+**	The file records the size and modification time of the sound file it
+**	was made from and is rebuilt when either changes. It is in native byte
+**	order and is rebuilt rather than read on a machine of another.
+**
+**	Include peaks.h first.
+*/
+
+#define	OVERVIEW_BLOCK		256
+
+/* Does path hold an up to date overview of sndfilepath? */
+bool overview_valid (const char * path, const char * sndfilepath) ;
+
+/*
+**	Read the whole of infile and write its overview to path. Returns false,
+**	with a message, if the file can not be written.
+*/
+bool overview_create (const char * path, const char * sndfilepath, SNDFILE * infile, const SF_INFO * info) ;
+
+/*
+**	Fill the bins of peaks, which must be empty and have the same channels
+**	and frames as the overview, from the coarsest level that is no coarser
+**	than one block per bin. Each block goes to the bin holding its first
+**	frame. Returns false, leaving peaks untouched, if the overview can not
+**	be read or the bins are narrower than OVERVIEW_BLOCK frames.
+*/
+bool overview_read_peaks (const char * path, PEAKS * peaks) ;
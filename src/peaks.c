@@ -0,0 +1,666 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "common.h"
+#include "peaks.h"
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__SSE2__)
+#define	HAVE_SSE2_KERNEL	1
+#include <emmintrin.h>
+#if defined (__GNUC__)
+/* AVX functions are built with a target attribute and picked at run time. */
+#define	HAVE_AVX_KERNEL		1
+#include <immintrin.h>
+#endif
+#endif
+
+/* Vector sums of squares are added into doubles every this many vectors. */
+#define	KERNEL_FLUSH		64
+
+/* The float value of a short, as sf_read_float () gives it. */
+#define	SHORT_SCALE			(1.0 / 0x8000)
+
+PEAKS *
+peaks_create (int bins, int channels, sf_count_t frames)
+{	PEAKS *peaks ;
+	int k ;
+
+	if ((peaks = calloc (1, sizeof (PEAKS))) == NULL
+			|| (peaks->bin = calloc ((size_t) bins * channels, sizeof (PEAK_BIN))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	peaks->bins = bins ;
+	peaks->channels = channels ;
+	peaks->frames = frames ;
+
+	for (k = 0 ; k < bins * channels ; k++)
+	{	peaks->bin [k].min = 1.0 ;
+		peaks->bin [k].max = -1.0 ;
+		} ;
+
+	return peaks ;
+} /* peaks_create */
+
+void
+peaks_destroy (PEAKS * peaks)
+{
+	free (peaks->bin) ;
+	free (peaks) ;
+} /* peaks_destroy */
+
+sf_count_t
+peaks_edge (const PEAKS * peaks, int k)
+{	/*
+	**	k * frames / bins, split so that it cannot overflow however many
+	**	frames there are : frames = q * bins + r with r < bins.
+	*/
+	sf_count_t q = peaks->frames / peaks->bins, r = peaks->frames % peaks->bins ;
+
+	return k * q + (k * r) / peaks->bins ;
+} /* peaks_edge */
+
+int
+peaks_bin (const PEAKS * peaks, sf_count_t frame)
+{	int k ;
+
+	/* The last bin whose first frame is <= frame, from a close guess. */
+	k = (int) ((double) frame * peaks->bins / peaks->frames) ;
+	k = MAX (0, MIN (k, peaks->bins - 1)) ;
+
+	while (k > 0 && peaks_edge (peaks, k) > frame)
+		k -- ;
+	while (k + 1 < peaks->bins && peaks_edge (peaks, k + 1) <= frame)
+		k ++ ;
+
+	return k ;
+} /* peaks_bin */
+
+void
+peaks_add (PEAKS * peaks, sf_count_t pos, const double * data, int count)
+{	int channels = peaks->channels, k = 0 ;
+
+	if (pos < 0)
+	{	data -= pos * channels ;
+		count += pos ;
+		pos = 0 ;
+		} ;
+
+	count = MIN (count, MAX (peaks->frames - pos, 0)) ;
+
+	while (k < count)
+	{	int b = peaks_bin (peaks, pos + k) ;
+		int end = MIN (count, peaks_edge (peaks, b + 1) - pos) ;
+		int ch ;
+
+		for (ch = 0 ; ch < channels ; ch++)
+		{	PEAK_BIN *bin = peaks->bin + ch * peaks->bins + b ;
+			float min = bin->min, max = bin->max ;
+			double sumsq = 0.0 ;
+			int i ;
+
+			for (i = k ; i < end ; i++)
+			{	double value = data [i * channels + ch] ;
+
+				min = MIN (min, value) ;
+				max = MAX (max, value) ;
+				sumsq += value * value ;
+				} ;
+
+			bin->min = min ;
+			bin->max = max ;
+			bin->sumsq += sumsq ;
+			bin->count += end - k ;
+			} ;
+
+		k = end ;
+		} ;
+} /* peaks_add */
+
+PEAKS *
+peaks_merge (const PEAKS * peaks, int bins, sf_count_t frames)
+{	PEAKS *merged ;
+	int k, ch ;
+
+	merged = peaks_create (bins, peaks->channels, frames) ;
+	merged->rms_window = peaks->rms_window ;
+
+	for (k = 0 ; k < peaks->bins ; k++)
+	{	sf_count_t first = peaks_edge (peaks, k) ;
+		int to ;
+
+		/* Bins can be empty if there are more of them than frames. */
+		if (first >= peaks_edge (peaks, k + 1) || first >= frames)
+			continue ;
+
+		to = peaks_bin (merged, first) ;
+		for (ch = 0 ; ch < peaks->channels ; ch++)
+		{	const PEAK_BIN *src = peaks->bin + ch * peaks->bins + k ;
+			PEAK_BIN *dest = merged->bin + ch * bins + to ;
+
+			dest->min = MIN (dest->min, src->min) ;
+			dest->max = MAX (dest->max, src->max) ;
+			dest->sumsq += src->sumsq ;
+			dest->count += src->count ;
+			dest->rms_max = MAX (dest->rms_max, src->rms_max) ;
+			} ;
+		} ;
+
+	return merged ;
+} /* peaks_merge */
+
+PEAKS *
+peaks_resize (const PEAKS * peaks, int bins)
+{	PEAKS *resized ;
+	int ch ;
+
+	resized = peaks_create (bins, peaks->channels, peaks->frames / peaks->bins * bins) ;
+	resized->rms_window = peaks->rms_window ;
+
+	for (ch = 0 ; ch < peaks->channels ; ch++)
+		memcpy (resized->bin + ch * bins, peaks->bin + ch * peaks->bins, MIN (bins, peaks->bins) * sizeof (PEAK_BIN)) ;
+
+	return resized ;
+} /* peaks_resize */
+
+void
+peaks_add_float (PEAKS * peaks, sf_count_t pos, const float * data, int count)
+{	int channels = peaks->channels, k = 0 ;
+
+	if (pos < 0)
+	{	data -= pos * channels ;
+		count += pos ;
+		pos = 0 ;
+		} ;
+
+	count = MIN (count, MAX (peaks->frames - pos, 0)) ;
+
+	while (k < count)
+	{	int b = peaks_bin (peaks, pos + k) ;
+		int end = MIN (count, peaks_edge (peaks, b + 1) - pos) ;
+
+		peaks_kernel (data + k * channels, end - k, channels, peaks->bin + b, peaks->bins) ;
+		k = end ;
+		} ;
+} /* peaks_add_float */
+
+void
+peaks_add_short (PEAKS * peaks, sf_count_t pos, const short * data, int count)
+{	int channels = peaks->channels, k = 0 ;
+
+	if (pos < 0)
+	{	data -= pos * channels ;
+		count += pos ;
+		pos = 0 ;
+		} ;
+
+	count = MIN (count, MAX (peaks->frames - pos, 0)) ;
+
+	while (k < count)
+	{	int b = peaks_bin (peaks, pos + k) ;
+		int end = MIN (count, peaks_edge (peaks, b + 1) - pos) ;
+
+		peaks_kernel_short (data + k * channels, end - k, channels, peaks->bin + b, peaks->bins) ;
+		k = end ;
+		} ;
+} /* peaks_add_short */
+
+void
+peaks_get (const PEAKS * peaks, int ch, int k, PEAK_BIN * bin)
+{	int c ;
+
+	if (ch >= 0)
+	{	*bin = peaks->bin [ch * peaks->bins + k] ;
+		return ;
+		} ;
+
+	*bin = peaks->bin [k] ;
+	for (c = 1 ; c < peaks->channels ; c++)
+	{	const PEAK_BIN *other = peaks->bin + c * peaks->bins + k ;
+
+		bin->min = MIN (bin->min, other->min) ;
+		bin->max = MAX (bin->max, other->max) ;
+		bin->sumsq += other->sumsq ;
+		bin->count += other->count ;
+		bin->rms_max = MAX (bin->rms_max, other->rms_max) ;
+		} ;
+} /* peaks_get */
+
+double
+peak_bin_rms (const PEAK_BIN * bin)
+{
+	return bin->count > 0 ? sqrt (bin->sumsq / bin->count) : 0.0 ;
+} /* peak_bin_rms */
+
+double
+peaks_rms (const PEAKS * peaks, const PEAK_BIN * bin)
+{
+	return peaks->rms_window > 0 ? bin->rms_max : peak_bin_rms (bin) ;
+} /* peaks_rms */
+
+RMS_WINDOW *
+rms_window_create (int channels, int length)
+{	RMS_WINDOW *window ;
+
+	if ((window = calloc (1, sizeof (RMS_WINDOW))) == NULL
+			|| (window->square = calloc ((size_t) length * channels, sizeof (float))) == NULL
+			|| (window->sumsq = calloc (channels, sizeof (double))) == NULL
+			|| (window->best = calloc (channels, sizeof (double))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	window->channels = channels ;
+	window->length = length ;
+
+	return window ;
+} /* rms_window_create */
+
+void
+rms_window_destroy (RMS_WINDOW * window)
+{
+	free (window->square) ;
+	free (window->sumsq) ;
+	free (window->best) ;
+	free (window) ;
+} /* rms_window_destroy */
+
+/* Move the window on by one frame. */
+static inline void
+rms_window_step (RMS_WINDOW * window, const float * frame)
+{	float *square = window->square + window->pos * window->channels ;
+	int ch ;
+
+	for (ch = 0 ; ch < window->channels ; ch++)
+	{	float value = frame [ch] * frame [ch] ;
+
+		window->sumsq [ch] += value - square [ch] ;
+		square [ch] = value ;
+		} ;
+
+	if (++ window->pos < window->length)
+		return ;
+
+	/* Once per lap, sum the ring again so rounding errors can not build up. */
+	window->pos = 0 ;
+	for (ch = 0 ; ch < window->channels ; ch++)
+	{	double sumsq = 0.0 ;
+		int k ;
+
+		for (k = 0 ; k < window->length ; k++)
+			sumsq += window->square [k * window->channels + ch] ;
+		window->sumsq [ch] = sumsq ;
+		} ;
+} /* rms_window_step */
+
+void
+rms_window_add (RMS_WINDOW * window, const float * data, int count)
+{	int k ;
+
+	for (k = 0 ; k < count ; k++)
+		rms_window_step (window, data + k * window->channels) ;
+} /* rms_window_add */
+
+void
+peaks_add_rms (PEAKS * peaks, RMS_WINDOW * window, sf_count_t pos, const float * data, int count)
+{	int channels = peaks->channels, k = 0, ch ;
+
+	if (pos < 0)
+	{	rms_window_add (window, data, MIN (count, -pos)) ;
+		data -= pos * channels ;
+		count += pos ;
+		pos = 0 ;
+		} ;
+
+	count = MIN (count, MAX (peaks->frames - pos, 0)) ;
+
+	while (k < count)
+	{	int b = peaks_bin (peaks, pos + k) ;
+		int end = MIN (count, peaks_edge (peaks, b + 1) - pos) ;
+
+		for (ch = 0 ; ch < channels ; ch++)
+			window->best [ch] = 0.0 ;
+
+		for ( ; k < end ; k++)
+		{	rms_window_step (window, data + k * channels) ;
+
+			for (ch = 0 ; ch < channels ; ch++)
+				window->best [ch] = MAX (window->best [ch], window->sumsq [ch]) ;
+			} ;
+
+		for (ch = 0 ; ch < channels ; ch++)
+		{	PEAK_BIN *bin = peaks->bin + ch * peaks->bins + b ;
+
+			bin->rms_max = MAX (bin->rms_max, sqrt (window->best [ch] / window->length)) ;
+			} ;
+		} ;
+} /* peaks_add_rms */
+
+/*------------------------------------------------------------------------------
+**	The kernels. A run of W frames of C channels is C vectors of W floats,
+**	and lane j of vector i of every run holds channel (W * i + j) % C, so
+**	each vector has its own accumulators and the lanes are only sorted
+**	into channels at the end.
+*/
+
+void
+peaks_kernel_scalar (const float * data, int count, int channels, PEAK_BIN * bin, int bin_stride)
+{	int ch, k ;
+
+	for (ch = 0 ; ch < channels ; ch++)
+	{	PEAK_BIN *dest = bin + ch * bin_stride ;
+		float min = dest->min, max = dest->max ;
+		double sumsq = 0.0 ;
+
+		for (k = 0 ; k < count ; k++)
+		{	float value = data [k * channels + ch] ;
+
+			min = MIN (min, value) ;
+			max = MAX (max, value) ;
+			sumsq += value * value ;
+			} ;
+
+		dest->min = min ;
+		dest->max = max ;
+		dest->sumsq += sumsq ;
+		dest->count += count ;
+		} ;
+} /* peaks_kernel_scalar */
+
+#if HAVE_SSE2_KERNEL
+static void
+kernel_sse2 (const float * data, int count, int channels, PEAK_BIN * bin, int bin_stride)
+{	__m128 vmin [KERNEL_CHANNELS], vmax [KERNEL_CHANNELS], vsum [KERNEL_CHANNELS] ;
+	float lane_min [4], lane_max [4], lane_sum [4] ;
+	double sumsq [KERNEL_CHANNELS] ;
+	int runs = count / 4, r, i, j ;
+
+	for (i = 0 ; i < channels ; i++)
+	{	vmin [i] = _mm_set1_ps (FLT_MAX) ;
+		vmax [i] = _mm_set1_ps (-FLT_MAX) ;
+		vsum [i] = _mm_setzero_ps () ;
+		sumsq [i] = 0.0 ;
+		} ;
+
+	for (r = 0 ; r < runs ; r++)
+	{	const float *run = data + 4 * channels * r ;
+
+		for (i = 0 ; i < channels ; i++)
+		{	__m128 v = _mm_loadu_ps (run + 4 * i) ;
+
+			vmin [i] = _mm_min_ps (vmin [i], v) ;
+			vmax [i] = _mm_max_ps (vmax [i], v) ;
+			vsum [i] = _mm_add_ps (vsum [i], _mm_mul_ps (v, v)) ;
+			} ;
+
+		if ((r + 1) % KERNEL_FLUSH == 0 || r + 1 == runs)
+			for (i = 0 ; i < channels ; i++)
+			{	_mm_storeu_ps (lane_sum, vsum [i]) ;
+				for (j = 0 ; j < 4 ; j++)
+					sumsq [(4 * i + j) % channels] += lane_sum [j] ;
+				vsum [i] = _mm_setzero_ps () ;
+				} ;
+		} ;
+
+	for (i = 0 ; i < channels ; i++)
+	{	_mm_storeu_ps (lane_min, vmin [i]) ;
+		_mm_storeu_ps (lane_max, vmax [i]) ;
+
+		for (j = 0 ; j < 4 ; j++)
+		{	PEAK_BIN *dest = bin + (4 * i + j) % channels * bin_stride ;
+
+			dest->min = MIN (dest->min, lane_min [j]) ;
+			dest->max = MAX (dest->max, lane_max [j]) ;
+			} ;
+
+		bin [i * bin_stride].sumsq += sumsq [i] ;
+		bin [i * bin_stride].count += 4 * runs ;
+		} ;
+
+	peaks_kernel_scalar (data + 4 * channels * runs, count - 4 * runs, channels, bin, bin_stride) ;
+} /* kernel_sse2 */
+#endif
+
+#if HAVE_AVX_KERNEL
+__attribute__ ((target ("avx"))) static void
+kernel_avx (const float * data, int count, int channels, PEAK_BIN * bin, int bin_stride)
+{	__m256 vmin [KERNEL_CHANNELS], vmax [KERNEL_CHANNELS], vsum [KERNEL_CHANNELS] ;
+	float lane_min [8], lane_max [8], lane_sum [8] ;
+	double sumsq [KERNEL_CHANNELS] ;
+	int runs = count / 8, r, i, j ;
+
+	for (i = 0 ; i < channels ; i++)
+	{	vmin [i] = _mm256_set1_ps (FLT_MAX) ;
+		vmax [i] = _mm256_set1_ps (-FLT_MAX) ;
+		vsum [i] = _mm256_setzero_ps () ;
+		sumsq [i] = 0.0 ;
+		} ;
+
+	for (r = 0 ; r < runs ; r++)
+	{	const float *run = data + 8 * channels * r ;
+
+		for (i = 0 ; i < channels ; i++)
+		{	__m256 v = _mm256_loadu_ps (run + 8 * i) ;
+
+			vmin [i] = _mm256_min_ps (vmin [i], v) ;
+			vmax [i] = _mm256_max_ps (vmax [i], v) ;
+			vsum [i] = _mm256_add_ps (vsum [i], _mm256_mul_ps (v, v)) ;
+			} ;
+
+		if ((r + 1) % KERNEL_FLUSH == 0 || r + 1 == runs)
+			for (i = 0 ; i < channels ; i++)
+			{	_mm256_storeu_ps (lane_sum, vsum [i]) ;
+				for (j = 0 ; j < 8 ; j++)
+					sumsq [(8 * i + j) % channels] += lane_sum [j] ;
+				vsum [i] = _mm256_setzero_ps () ;
+				} ;
+		} ;
+
+	for (i = 0 ; i < channels ; i++)
+	{	_mm256_storeu_ps (lane_min, vmin [i]) ;
+		_mm256_storeu_ps (lane_max, vmax [i]) ;
+
+		for (j = 0 ; j < 8 ; j++)
+		{	PEAK_BIN *dest = bin + (8 * i + j) % channels * bin_stride ;
+
+			dest->min = MIN (dest->min, lane_min [j]) ;
+			dest->max = MAX (dest->max, lane_max [j]) ;
+			} ;
+
+		bin [i * bin_stride].sumsq += sumsq [i] ;
+		bin [i * bin_stride].count += 8 * runs ;
+		} ;
+
+	peaks_kernel_scalar (data + 8 * channels * runs, count - 8 * runs, channels, bin, bin_stride) ;
+} /* kernel_avx */
+#endif
+
+void
+peaks_kernel (const float * data, int count, int channels, PEAK_BIN * bin, int bin_stride)
+{
+#if HAVE_AVX_KERNEL
+	if (channels <= KERNEL_CHANNELS && __builtin_cpu_supports ("avx"))
+	{	kernel_avx (data, count, channels, bin, bin_stride) ;
+		return ;
+		} ;
+#endif
+#if HAVE_SSE2_KERNEL
+	if (channels <= KERNEL_CHANNELS)
+	{	kernel_sse2 (data, count, channels, bin, bin_stride) ;
+		return ;
+		} ;
+#endif
+	peaks_kernel_scalar (data, count, channels, bin, bin_stride) ;
+} /* peaks_kernel */
+
+/*------------------------------------------------------------------------------
+**	The short kernels keep the min and max as shorts and the sum of squares
+**	as an exact 64 bit integer, and only scale them to floats at the end.
+*/
+
+/* Merge the integer results for one channel into a bin. */
+static void
+short_result (PEAK_BIN * dest, int min, int max, int64_t sumsq, int count)
+{
+	dest->min = MIN (dest->min, (float) (min * SHORT_SCALE)) ;
+	dest->max = MAX (dest->max, (float) (max * SHORT_SCALE)) ;
+	dest->sumsq += sumsq * (SHORT_SCALE * SHORT_SCALE) ;
+	dest->count += count ;
+} /* short_result */
+
+static void
+kernel_short_scalar (const short * data, int count, int channels, PEAK_BIN * bin, int bin_stride)
+{	int ch, k ;
+
+	if (count <= 0)
+		return ;
+
+	for (ch = 0 ; ch < channels ; ch++)
+	{	int min = SHRT_MAX, max = SHRT_MIN ;
+		int64_t sumsq = 0 ;
+
+		for (k = 0 ; k < count ; k++)
+		{	int value = data [k * channels + ch] ;
+
+			min = MIN (min, value) ;
+			max = MAX (max, value) ;
+			sumsq += value * value ;
+			} ;
+
+		short_result (bin + ch * bin_stride, min, max, sumsq, count) ;
+		} ;
+} /* kernel_short_scalar */
+
+#if HAVE_SSE2_KERNEL
+static void
+kernel_short_sse2 (const short * data, int count, int channels, PEAK_BIN * bin, int bin_stride)
+{	__m128i vmin [KERNEL_CHANNELS], vmax [KERNEL_CHANNELS], vsum [KERNEL_CHANNELS][4] ;
+	const __m128i zero = _mm_setzero_si128 () ;
+	short lane_min [8], lane_max [8] ;
+	int64_t lane_sum [2], sumsq [KERNEL_CHANNELS] ;
+	int min [KERNEL_CHANNELS], max [KERNEL_CHANNELS] ;
+	int runs = count / 8, r, i, j, q ;
+
+	for (i = 0 ; i < channels ; i++)
+	{	vmin [i] = _mm_set1_epi16 (SHRT_MAX) ;
+		vmax [i] = _mm_set1_epi16 (SHRT_MIN) ;
+		for (q = 0 ; q < 4 ; q++)
+			vsum [i][q] = zero ;
+		min [i] = SHRT_MAX ;
+		max [i] = SHRT_MIN ;
+		sumsq [i] = 0 ;
+		} ;
+
+	/*
+	**	Two runs at a time, as the sum of two squares of shorts still fits
+	**	an unsigned 32 bit lane, and then a last run on its own.
+	*/
+	for (r = 0 ; r < runs ; r += 2)
+	{	const short *run = data + 8 * channels * r ;
+
+		for (i = 0 ; i < channels ; i++)
+		{	__m128i v = _mm_loadu_si128 ((const __m128i *) (run + 8 * i)), lo, hi, sq0, sq1 ;
+
+			vmin [i] = _mm_min_epi16 (vmin [i], v) ;
+			vmax [i] = _mm_max_epi16 (vmax [i], v) ;
+
+			/* The 32 bit squares of lanes 0-3 and 4-7. */
+			lo = _mm_mullo_epi16 (v, v) ;
+			hi = _mm_mulhi_epi16 (v, v) ;
+			sq0 = _mm_unpacklo_epi16 (lo, hi) ;
+			sq1 = _mm_unpackhi_epi16 (lo, hi) ;
+
+			if (r + 1 < runs)
+			{	v = _mm_loadu_si128 ((const __m128i *) (run + 8 * channels + 8 * i)) ;
+
+				vmin [i] = _mm_min_epi16 (vmin [i], v) ;
+				vmax [i] = _mm_max_epi16 (vmax [i], v) ;
+
+				lo = _mm_mullo_epi16 (v, v) ;
+				hi = _mm_mulhi_epi16 (v, v) ;
+				sq0 = _mm_add_epi32 (sq0, _mm_unpacklo_epi16 (lo, hi)) ;
+				sq1 = _mm_add_epi32 (sq1, _mm_unpackhi_epi16 (lo, hi)) ;
+				} ;
+
+			/* Widened to 64 bits in pairs of lanes. */
+			vsum [i][0] = _mm_add_epi64 (vsum [i][0], _mm_unpacklo_epi32 (sq0, zero)) ;
+			vsum [i][1] = _mm_add_epi64 (vsum [i][1], _mm_unpackhi_epi32 (sq0, zero)) ;
+			vsum [i][2] = _mm_add_epi64 (vsum [i][2], _mm_unpacklo_epi32 (sq1, zero)) ;
+			vsum [i][3] = _mm_add_epi64 (vsum [i][3], _mm_unpackhi_epi32 (sq1, zero)) ;
+			} ;
+		} ;
+
+	for (i = 0 ; i < channels ; i++)
+	{	_mm_storeu_si128 ((__m128i *) lane_min, vmin [i]) ;
+		_mm_storeu_si128 ((__m128i *) lane_max, vmax [i]) ;
+
+		for (j = 0 ; j < 8 ; j++)
+		{	int ch = (8 * i + j) % channels ;
+
+			min [ch] = MIN (min [ch], lane_min [j]) ;
+			max [ch] = MAX (max [ch], lane_max [j]) ;
+			} ;
+
+		for (q = 0 ; q < 4 ; q++)
+		{	_mm_storeu_si128 ((__m128i *) lane_sum, vsum [i][q]) ;
+			for (j = 0 ; j < 2 ; j++)
+				sumsq [(8 * i + 2 * q + j) % channels] += lane_sum [j] ;
+			} ;
+		} ;
+
+	if (runs > 0)
+		for (i = 0 ; i < channels ; i++)
+			short_result (bin + i * bin_stride, min [i], max [i], sumsq [i], 8 * runs) ;
+
+	kernel_short_scalar (data + 8 * channels * runs, count - 8 * runs, channels, bin, bin_stride) ;
+} /* kernel_short_sse2 */
+#endif
+
+void
+peaks_kernel_short (const short * data, int count, int channels, PEAK_BIN * bin, int bin_stride)
+{
+#if HAVE_SSE2_KERNEL
+	if (channels <= KERNEL_CHANNELS)
+	{	kernel_short_sse2 (data, count, channels, bin, bin_stride) ;
+		return ;
+		} ;
+#endif
+	kernel_short_scalar (data, count, channels, bin, bin_stride) ;
+} /* peaks_kernel_short */
+
+const char *
+peaks_kernel_name (void)
+{
+#if HAVE_AVX_KERNEL
+	if (__builtin_cpu_supports ("avx"))
+		return "avx" ;
+#endif
+#if HAVE_SSE2_KERNEL
+	return "sse2" ;
+#else
+	return "scalar" ;
+#endif
+} /* peaks_kernel_name */
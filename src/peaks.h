@@ -0,0 +1,134 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sndfile.h>
+
+/*
+**	Min/max/RMS binning of audio for waveform displays.
+**
+**	Bin k covers frames [edge (k), edge (k + 1)) where edge (k) is
+**	k * frames / bins rounded down, so every frame lands in exactly one bin
+**	whatever order or chunk size the audio is added in. The edges are exact
+**	in 64 bit integers for any number of frames and bins. Each channel has
+**	its own run of bins.
+*/
+
+typedef struct
+{	float min, max ;
+	double sumsq ;
+	sf_count_t count ;
+	float rms_max ;		/* Highest sliding window RMS, see peaks_add_rms (). */
+} PEAK_BIN ;
+
+typedef struct
+{	int bins, channels ;
+	sf_count_t frames ;
+	int rms_window ;	/* Frames in the sliding RMS window, 0 for none. */
+	PEAK_BIN *bin ;		/* Bin k of channel ch is bin [ch * bins + k]. */
+} PEAKS ;
+
+/* Running sums of squares over the last length frames of each channel. */
+typedef struct
+{	int channels, length, pos ;
+	float *square ;		/* Ring of length frames of squares. */
+	double *sumsq ;
+	double *best ;		/* Highest sumsq in the current bin. */
+} RMS_WINDOW ;
+
+PEAKS * peaks_create (int bins, int channels, sf_count_t frames) ;
+
+void peaks_destroy (PEAKS * peaks) ;
+
+/* First frame of bin k, k may be bins to get the end of the last bin. */
+sf_count_t peaks_edge (const PEAKS * peaks, int k) ;
+
+/* The bin holding frame, which must be in [0, frames). */
+int peaks_bin (const PEAKS * peaks, sf_count_t frame) ;
+
+/*
+**	Add count interleaved frames starting at frame pos. Frames past the end
+**	are ignored.
+*/
+void peaks_add (PEAKS * peaks, sf_count_t pos, const double * data, int count) ;
+
+/*
+**	New bins of the first frames frames, each the merge of the old bins
+**	whose first frame it holds. The result is exact when bins divides
+**	peaks->bins and frames is peaks->frames.
+*/
+PEAKS * peaks_merge (const PEAKS * peaks, int bins, sf_count_t frames) ;
+
+/*
+**	Bins of the same size as those of peaks, which must all be the same
+**	size, bins of them. The first bins are copied and any new ones are empty.
+*/
+PEAKS * peaks_resize (const PEAKS * peaks, int bins) ;
+
+/* As peaks_add () for the float frames sf_readf_float () gives. */
+void peaks_add_float (PEAKS * peaks, sf_count_t pos, const float * data, int count) ;
+
+/*
+**	As peaks_add_float () for the frames sf_readf_short () gives, which for
+**	16 bit or smaller PCM are the samples themselves. The bins come out the
+**	same, the sums of squares a little more exact.
+*/
+void peaks_add_short (PEAKS * peaks, sf_count_t pos, const short * data, int count) ;
+
+/* Get bin k of channel ch, or of all channels together if ch is -1. */
+void peaks_get (const PEAKS * peaks, int ch, int k, PEAK_BIN * bin) ;
+
+/* RMS of a bin, 0.0 if it is empty. */
+double peak_bin_rms (const PEAK_BIN * bin) ;
+
+/* rms_max of a bin if peaks has a sliding RMS window, else peak_bin_rms (). */
+double peaks_rms (const PEAKS * peaks, const PEAK_BIN * bin) ;
+
+/*
+**	Sliding window RMS. Each frame updates the window in constant time and
+**	the RMS of the window ending at each frame goes into rms_max of the
+**	frame's bin, so the RMS envelope does not depend on the bin width. The
+**	window starts out as silence.
+*/
+RMS_WINDOW * rms_window_create (int channels, int length) ;
+void rms_window_destroy (RMS_WINDOW * window) ;
+
+/* Run frames through the window without touching any bins. */
+void rms_window_add (RMS_WINDOW * window, const float * data, int count) ;
+
+/* As rms_window_add (), also updating the bins of the frames from pos. */
+void peaks_add_rms (PEAKS * peaks, RMS_WINDOW * window, sf_count_t pos, const float * data, int count) ;
+
+/*
+**	The vector kernels keep one accumulator per channel in registers, so
+**	they take at most this many channels and the scalar loop does the rest.
+*/
+#define	KERNEL_CHANNELS		16
+
+/*
+**	Merge count interleaved frames into bin [ch * bin_stride] for each
+**	channel ch. This is the inner loop of peaks_add_float (), vectorized
+**	with SSE2 or AVX where the CPU has them. peaks_kernel_scalar () is the
+**	plain C version, for comparison.
+*/
+void peaks_kernel (const float * data, int count, int channels, PEAK_BIN * bin, int bin_stride) ;
+void peaks_kernel_scalar (const float * data, int count, int channels, PEAK_BIN * bin, int bin_stride) ;
+
+/* As peaks_kernel () for shorts, using SSE2 where the CPU has it. */
+void peaks_kernel_short (const short * data, int count, int channels, PEAK_BIN * bin, int bin_stride) ;
+
+/* The instruction set peaks_kernel () uses on this CPU. */
+const char * peaks_kernel_name (void) ;
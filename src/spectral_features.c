@@ -0,0 +1,162 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "common.h"
+#include "spectral_features.h"
+
+#define	ROLLOFF_FRACTION	0.85
+#define	LOWEST_BAND_FREQ	31.25
+
+/* Added to powers before taking logs so silence stays finite. */
+#define	POWER_FLOOR			1e-20
+
+FEATURES *
+features_open (const char * path, int speclen, int samplerate, const double * window)
+{	FEATURES *feat ;
+	const char *ext ;
+	double sum, sum2 ;
+	int k ;
+
+	if ((feat = calloc (1, sizeof (FEATURES))) == NULL
+			|| (feat->prev = calloc (speclen + 1, sizeof (double))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	if ((feat->file = fopen (path, "w")) == NULL)
+	{	printf ("Error : Not able to open features file '%s'\n", path) ;
+		exit (1) ;
+		} ;
+
+	ext = strrchr (path, '.') ;
+	feat->binary = (ext != NULL && strcmp (ext, ".bin") == 0) ;
+	feat->speclen = speclen ;
+	feat->bin_width = 0.5 * samplerate / speclen ;
+
+	/* A full scale sine wave peaks at half the window sum. Its power is
+	** spread over the window's equivalent noise bandwidth, which is taken
+	** out of the band powers.
+	*/
+	sum = sum2 = 0.0 ;
+	for (k = 0 ; k < 2 * speclen ; k++)
+	{	double w = window != NULL ? window [k] : 1.0 ;
+
+		sum += w ;
+		sum2 += w * w ;
+		} ;
+	feat->ref_mag = 0.5 * sum ;
+	feat->enbw = 2 * speclen * sum2 / (sum * sum) ;
+
+	/* Octave bands [fc / sqrt (2), fc * sqrt (2)) up to Nyquist. */
+	for (k = 0 ; k < ARRAY_LEN (feat->band_start) ; k++)
+	{	double fc = LOWEST_BAND_FREQ * pow (2.0, k) ;
+
+		if (fc * M_SQRT1_2 >= 0.5 * samplerate)
+			break ;
+
+		feat->band_start [k] = lrint (ceil (fc * M_SQRT1_2 / feat->bin_width)) ;
+		feat->band_end [k] = MIN (lrint (ceil (fc * M_SQRT2 / feat->bin_width)), speclen + 1) ;
+		} ;
+	feat->bands = k ;
+
+	if (! feat->binary)
+	{	fprintf (feat->file, "time,centroid,flatness,rolloff,flux") ;
+		for (k = 0 ; k < feat->bands ; k++)
+			fprintf (feat->file, ",band_%d", (int) lrint (LOWEST_BAND_FREQ * pow (2.0, k))) ;
+		fprintf (feat->file, "\n") ;
+		} ;
+
+	return feat ;
+} /* features_open */
+
+void
+features_add_column (FEATURES * feat, double time, const double * mag_spec)
+{	double row [5 + ARRAY_LEN (feat->band_start)] ;
+	double power, mag_sum, weighted, log_sum, flux, target, sum ;
+	int k, count ;
+
+	power = mag_sum = weighted = log_sum = flux = 0.0 ;
+
+	for (k = 0 ; k <= feat->speclen ; k++)
+	{	double m = mag_spec [k] / feat->ref_mag ;
+		double p = m * m ;
+
+		power += p ;
+		mag_sum += m ;
+		weighted += m * k ;
+		log_sum += log (p + POWER_FLOOR) ;
+
+		if (feat->have_prev && m > feat->prev [k])
+			flux += (m - feat->prev [k]) * (m - feat->prev [k]) ;
+		feat->prev [k] = m ;
+		} ;
+	feat->have_prev = true ;
+
+	row [0] = time ;
+	row [1] = mag_sum > 0.0 ? feat->bin_width * weighted / mag_sum : 0.0 ;
+	row [2] = exp (log_sum / (feat->speclen + 1)) / (power / (feat->speclen + 1) + POWER_FLOOR) ;
+
+	target = ROLLOFF_FRACTION * power ;
+	for (k = 0, sum = 0.0 ; k < feat->speclen ; k++)
+	{	sum += feat->prev [k] * feat->prev [k] ;
+		if (sum >= target)
+			break ;
+		} ;
+	row [3] = k * feat->bin_width ;
+	row [4] = sqrt (flux) ;
+
+	for (count = 0 ; count < feat->bands ; count++)
+	{	double band = 0.0 ;
+
+		for (k = feat->band_start [count] ; k < feat->band_end [count] ; k++)
+			band += feat->prev [k] * feat->prev [k] ;
+		row [5 + count] = 10.0 * log10 (band / feat->enbw + POWER_FLOOR) ;
+		} ;
+	count += 5 ;
+
+	if (feat->binary)
+	{	float frow [ARRAY_LEN (row)] ;
+
+		for (k = 0 ; k < count ; k++)
+			frow [k] = row [k] ;
+		fwrite (frow, sizeof (frow [0]), count, feat->file) ;
+		return ;
+		} ;
+
+	fprintf (feat->file, "%.6f,%.2f,%.6g,%.2f,%.6g", row [0], row [1], row [2], row [3], row [4]) ;
+	for (k = 5 ; k < count ; k++)
+		fprintf (feat->file, ",%.2f", row [k]) ;
+	fprintf (feat->file, "\n") ;
+} /* features_add_column */
+
+void
+features_close (FEATURES * feat)
+{
+	if (fclose (feat->file) != 0)
+	{	printf ("Error : Failed writing the features file.\n") ;
+		exit (1) ;
+		} ;
+
+	free (feat->prev) ;
+	free (feat) ;
+} /* features_close */
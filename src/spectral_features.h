@@ -0,0 +1,58 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/*
+**	Per column spectral features, written as one row per spectrogram column:
+**
+**		time		centre of the column in seconds
+**		centroid	spectral centroid in Hz
+**		flatness	geometric over arithmetic mean of the power spectrum
+**		rolloff		frequency in Hz below which 85% of the power lies
+**		flux		L2 norm of the rise in magnitude since the last column
+**		band_<f>	power in dBFS of the octave band centred on f Hz,
+**					31Hz up to the highest band below Nyquist.
+**
+**	A file name ending in ".bin" gives rows of native float32 values in
+**	the order above, anything else CSV with a header line.
+*/
+
+typedef struct
+{	FILE *file ;
+	bool binary ;
+	int speclen, bands ;
+	double bin_width ;	/* Hz per spectrum element. */
+	double ref_mag ;	/* Magnitude of a full scale sine wave. */
+	double enbw ;		/* Equivalent noise bandwidth of the window in bins. */
+	double *prev ;		/* Previous column, normalised to ref_mag. */
+	bool have_prev ;
+	int band_start [16] ;
+	int band_end [16] ;
+} FEATURES ;
+
+/*
+**	window is the 2 * speclen point analysis window, NULL if rectangular.
+**	mag_spec passed to features_add_column has speclen + 1 elements from
+**	0Hz to the Nyquist frequency. Exits on error.
+*/
+FEATURES * features_open (const char * path, int speclen, int samplerate, const double * window) ;
+
+void features_add_column (FEATURES * feat, double time, const double * mag_spec) ;
+
+void features_close (FEATURES * feat) ;
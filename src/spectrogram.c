@@ -41,6 +41,9 @@
 #include "window.h"
 #include "common.h"
 #include "spectrum.h"
+#include "image.h"
+#include "spectral_features.h"
+#include "peaks.h"
 
 #define TICK_LEN			6
 #define	BORDER_LINE_WIDTH	1.8
@@ -53,22 +56,51 @@
 #define	RIGHT_BORDER		75.0
 #define	BOTTOM_BORDER		40.0
 
+/* Space between the --waveform lane and the spectrogram. */
+#define	LANE_GAP			8
+
 #define	SPEC_FLOOR_DB		-180.0
 
+/* Resolution and range of the --auto-range magnitude histogram. */
+#define	HIST_STEPS_PER_DB	10
+#define	HIST_MIN_DB			(-400)
+#define	HIST_MAX_DB			400
+#define	HIST_LEN			((HIST_MAX_DB - HIST_MIN_DB) * HIST_STEPS_PER_DB)
+
 
 typedef struct
-{	const char *sndfilepath, *pngfilepath, *filename ;
+{	const char *sndfilepath, *pngfilepath, *filename, *featurespath ;
 	int width, height ;
-	bool border, log_freq, gray_scale ;
+	bool border, log_freq, gray_scale, zoom, cqt ;
 	double min_freq, max_freq, fft_freq ;
 	enum WINDOW_FUNCTION window_function ;
 	double spec_floor_db ;
+	double auto_range ;		/* Percentile for --auto-range, 0.0 if off. */
+	double px_per_sec ;		/* Columns per second for --px-per-sec, 0.0 if off. */
+	int waveform_height ;	/* Height of the --waveform lane, 0 if off. */
+	IMAGE_OPTIONS image ;
 } RENDER ;
 
 typedef struct
 {	int left, top, width, height ;
 } RECT ;
 
+/* Sliding window onto the mono mix of a file that is only read sequentially. */
+typedef struct
+{	SNDFILE *file ;
+	double *data ;		/* Frames [start, start + count) */
+	sf_count_t start ;
+	int size, count ;
+	bool eof ;
+	PEAKS *peaks ;		/* If not NULL, gets every frame as it is read. */
+} STREAM ;
+
+/* Histogram of the absolute level in dB of every value in the spectrogram. */
+typedef struct
+{	double count [HIST_LEN] ;
+	double total ;
+} DB_HIST ;
+
 static void
 get_colour_map_value (float value, double spec_floor_db, unsigned char colour [3], bool gray_scale)
 {	static unsigned char map [][3] =
@@ -170,6 +202,104 @@ read_mono_audio (SNDFILE * file, sf_count_t filelen, double * data, int datalen,
 	return ;
 } /* read_mono_audio */
 
+/*
+**	Copy frames [start, start + datalen) of the stream to data, with zeros
+**	before the first frame and after the last. start must never decrease
+**	between calls. Returns false once the centre of the range is past the
+**	end of the stream, data is still filled in.
+*/
+static bool
+stream_read (STREAM * stream, double * data, sf_count_t start, int datalen)
+{	sf_count_t end = start + datalen, k ;
+
+	/* Drop the frames before start, reading past any gap between reads. */
+	if (start > stream->start)
+	{	int drop = MIN (start - stream->start, stream->count) ;
+
+		memmove (stream->data, stream->data + drop, (stream->count - drop) * sizeof (stream->data [0])) ;
+		stream->count -= drop ;
+		stream->start += drop ;
+
+		while (! stream->eof && stream->start < start)
+		{	sf_count_t got = sfx_mix_mono_read_double (stream->file, stream->data, MIN (stream->size, start - stream->start)) ;
+
+			if (got <= 0)
+				stream->eof = true ;
+			else if (stream->peaks != NULL)
+				peaks_add (stream->peaks, stream->start, stream->data, got) ;
+			stream->start += MAX (got, 0) ;
+			} ;
+		} ;
+
+	while (! stream->eof && stream->start + stream->count < end)
+	{	sf_count_t got = sfx_mix_mono_read_double (stream->file, stream->data + stream->count,
+						MIN (stream->size - stream->count, end - stream->start - stream->count)) ;
+
+		if (got <= 0)
+			stream->eof = true ;
+		else if (stream->peaks != NULL)
+			peaks_add (stream->peaks, stream->start + stream->count, stream->data + stream->count, got) ;
+		stream->count += MAX (got, 0) ;
+		} ;
+
+	memset (data, 0, datalen * sizeof (data [0])) ;
+	for (k = MAX (start, stream->start) ; k < MIN (end, stream->start + stream->count) ; k++)
+		data [k - start] = stream->data [k - stream->start] ;
+
+	return ! (stream->eof && start + datalen / 2 >= stream->start + stream->count) ;
+} /* stream_read */
+
+/*
+**	Read the audio for column indx of total. Without peaks to collect it is
+**	quicker to seek past the gaps between columns than to read through them.
+*/
+static void
+read_column (STREAM * stream, sf_count_t filelen, double * data, int datalen, int indx, int total)
+{
+	if (stream->peaks == NULL)
+		read_mono_audio (stream->file, filelen, data, datalen, indx, total) ;
+	else
+		stream_read (stream, data, (indx * filelen) / total - datalen / 2, datalen) ;
+} /* read_column */
+
+static void
+hist_add_column (DB_HIST * hist, const float * mag, int len)
+{	int k, indx ;
+
+	for (k = 0 ; k < len ; k++)
+	{	if (mag [k] <= 0.0)
+			indx = 0 ;
+		else
+		{	indx = lrint ((20.0 * log10 (mag [k]) - HIST_MIN_DB) * HIST_STEPS_PER_DB) ;
+			indx = MAX (0, MIN (indx, HIST_LEN - 1)) ;
+			} ;
+		hist->count [indx] += 1.0 ;
+		} ;
+
+	hist->total += len ;
+} /* hist_add_column */
+
+/*
+**	Return the floor for the colour map, in dB relative to max_mag, so that
+**	the given percentage of the spectrogram values fall below it.
+*/
+static double
+hist_floor_db (const DB_HIST * hist, double percentile, double max_mag)
+{	double target, sum = 0.0 ;
+	int k ;
+
+	target = hist->total * percentile / 100.0 ;
+
+	for (k = 0 ; k < HIST_LEN - 1 ; k++)
+	{	sum += hist->count [k] ;
+		if (sum >= target)
+			break ;
+		} ;
+
+	/* Everything at or below the max is black otherwise, so keep at least 1dB. */
+	return MIN (HIST_MIN_DB + (double) k / HIST_STEPS_PER_DB - 20.0 * log10 (max_mag), -1.0) ;
+} /* hist_floor_db */
+
 static void
 render_spectrogram (cairo_surface_t * surface, double spec_floor_db, float **mag2d, double maxval, double left, double top, double width, double height, bool gray_scale)
 {
@@ -494,7 +624,7 @@ str_print_value (char * text, int text_len, double value, int decimal_places_to_
 } /* str_print_value */
 
 static void
-render_spect_border (cairo_surface_t * surface, const char * filename, double left, double width, double seconds, double top, double height, double min_freq, double max_freq, bool log_freq)
+render_spect_border (cairo_surface_t * surface, const char * filename, double left, double width, double seconds, double title_top, double top, double height, double min_freq, double max_freq, bool log_freq)
 {
 	char text [512] ;
 	cairo_t * cr ;
@@ -515,7 +645,7 @@ render_spect_border (cairo_surface_t * surface, const char * filename, double le
 
 	snprintf (text, sizeof (text), "Spectrogram: %s", filename) ;
 	cairo_text_extents (cr, text, &extents) ;
-	cairo_move_to (cr, left + 2, top - extents.height / 2) ;
+	cairo_move_to (cr, left + 2, title_top - extents.height / 2) ;
 	cairo_show_text (cr, text) ;
 
 	/* Print labels. */
@@ -615,17 +745,71 @@ render_heat_border (cairo_surface_t * surface, double magfloor, const RECT *r)
 	cairo_destroy (cr) ;
 } /* render_heat_border */
 
+/* Draw the min/max and RMS of each bin of the mono mix, full scale is the lane height. */
+static void
+render_waveform_lane (cairo_surface_t * surface, const PEAKS * peaks, const RECT * r, bool border)
+{	cairo_t * cr ;
+	double centre, scale ;
+	int k ;
+
+	cr = cairo_create (surface) ;
+
+	centre = r->top + 0.5 * r->height ;
+	scale = 0.5 * r->height ;
+
+	cairo_set_line_width (cr, 1.0) ;
+
+	/* Peaks. */
+	cairo_set_source_rgb (cr, 0.5, 0.5, 0.55) ;
+	for (k = 0 ; k < peaks->bins && k < r->width ; k++)
+	{	PEAK_BIN bin ;
+
+		peaks_get (peaks, 0, k, &bin) ;
+		if (bin.count == 0)
+			continue ;
+
+		cairo_move_to (cr, r->left + k + 0.5, centre - scale * MAX (-1.0, MIN (1.0, bin.max)) - 0.5) ;
+		cairo_line_to (cr, r->left + k + 0.5, centre - scale * MAX (-1.0, MIN (1.0, bin.min)) + 0.5) ;
+		} ;
+	cairo_stroke (cr) ;
+
+	/* RMS. */
+	cairo_set_source_rgb (cr, 0.85, 0.85, 0.9) ;
+	for (k = 0 ; k < peaks->bins && k < r->width ; k++)
+	{	PEAK_BIN bin ;
+		double rms ;
+
+		peaks_get (peaks, 0, k, &bin) ;
+		if (bin.count == 0)
+			continue ;
+
+		rms = MIN (1.0, peak_bin_rms (&bin)) ;
+		cairo_move_to (cr, r->left + k + 0.5, centre - scale * rms - 0.5) ;
+		cairo_line_to (cr, r->left + k + 0.5, centre + scale * rms + 0.5) ;
+		} ;
+	cairo_stroke (cr) ;
+
+	if (border)
+	{	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0) ;
+		cairo_set_line_width (cr, BORDER_LINE_WIDTH) ;
+		cairo_rectangle (cr, r->left, r->top, r->width, r->height) ;
+		cairo_stroke (cr) ;
+		} ;
+
+	cairo_destroy (cr) ;
+} /* render_waveform_lane */
+
 /* Helper function:
 ** Map the index for an output pixel in a column to an index into the
 ** FFT result representing the same frequency.
 ** magindex is from 0 to maglen-1, representing min_freq to max_freq Hz.
-** Return values from are from 0 to speclen representing frequencies from
-** 0 to the Nyquist frequency.
+** Spectrum element k represents base_freq + k * bin_width Hz, which is
+** 0 Hz to the Nyquist frequency for elements 0 to speclen of a full FFT.
 ** The result is a floating point number as it may fall between elements,
 ** allowing the caller to interpolate onto the input array.
 */
 static double
-magindex_to_specindex (int speclen, int maglen, int magindex, double min_freq, double max_freq, int samplerate, bool log_freq)
+magindex_to_specindex (int maglen, int magindex, double min_freq, double max_freq, double base_freq, double bin_width, bool log_freq)
 {
 	double freq ; /* The frequency that this output value represents */
 
@@ -634,14 +818,14 @@ magindex_to_specindex (int speclen, int maglen, int magindex, double min_freq, d
 	else
 		freq = min_freq * pow (max_freq / min_freq, (double) magindex / (maglen - 1)) ;
 
-	return (freq * speclen / (samplerate / 2)) ;
+	return (freq - base_freq) / bin_width ;
 }
 
 /* Map values from the spectrogram onto an array of magnitudes, the values
 ** for display. Reads spec[0..speclen], writes mag[0..maglen-1].
 */
 static void
-interp_spec (float * mag, int maglen, const double *spec, int speclen, const RENDER *render, int samplerate)
+interp_spec (float * mag, int maglen, const double *spec, int speclen, const RENDER *render, double base_freq, double bin_width)
 {
 	int k ;
 
@@ -653,18 +837,19 @@ interp_spec (float * mag, int maglen, const double *spec, int speclen, const REN
 	** output value's coordinate falls between.
 	**
 	** spec points to an array with elements [0..speclen] inclusive
-	** representing frequencies from 0 to samplerate/2 Hz. Map these to the
+	** representing frequencies from base_freq to base_freq + speclen *
+	** bin_width Hz (0 to samplerate/2 Hz for a full FFT). Map these to the
 	** scale values min_freq to max_freq so that the bottom and top pixels
 	** in the output represent the energy in the sound at min_ and max_freq Hz.
 	*/
 
 	for (k = 0 ; k < maglen ; k++)
 	{	/* Average the pixels in the range it comes from */
-		double this = magindex_to_specindex (speclen, maglen, k,
-						render->min_freq, render->max_freq, samplerate,
+		double this = magindex_to_specindex (maglen, k,
+						render->min_freq, render->max_freq, base_freq, bin_width,
 						render->log_freq) ;
-		double next = magindex_to_specindex (speclen, maglen, k+1,
-						render->min_freq, render->max_freq, samplerate,
+		double next = magindex_to_specindex (maglen, k+1,
+						render->min_freq, render->max_freq, base_freq, bin_width,
 						render->log_freq) ;
 
 		/* Range check: can happen if --max-freq > samplerate / 2 */
@@ -742,14 +927,62 @@ is_good_speclen (int n)
 						|| ((n % 13 == 0) && is_2357 (n / 13)) ;
 }
 
+/*
+** Choose a speclen value, the spectrum length.
+** The FFT window size is twice this.
+*/
+static int
+choose_speclen (const RENDER * render, int samplerate, int height)
+{	int speclen, d ;
+
+	if (render->fft_freq != 0.0)
+		/* Choose an FFT window size of 1/fft_freq seconds of audio */
+		speclen = (samplerate / render->fft_freq + 1) / 2 ;
+	else
+		/* Long enough to represent frequencies down to 20Hz. */
+		speclen = height * (samplerate / 20 / height + 1) ;
+
+	/* Find the nearest fast value for the FFT size. */
+	for (d = 0 ; /* Will terminate */ ; d++)
+	{	/* Logarithmically, the integer above is closer than
+		** the integer below, so prefer it to the one below.
+		*/
+		if (is_good_speclen (speclen + d))
+			return speclen + d ;
+
+		/* FFT length must also be >= the output height,
+		** otherwise repeated pixel rows occur in the output.
+		*/
+		if (speclen - d >= height && is_good_speclen (speclen - d))
+			return speclen - d ;
+		} ;
+} /* choose_speclen */
+
+/* A full scale sine wave peaks at half the sum of the window. */
+static double
+full_scale_magnitude (const spectrum * spec)
+{	double sum = 0.0 ;
+	int k ;
+
+	for (k = 0 ; k < 2 * spec->speclen ; k++)
+		sum += spec->window != NULL ? spec->window [k] : 1.0 ;
+
+	return 0.5 * sum ;
+} /* full_scale_magnitude */
+
 static void
 render_to_surface (const RENDER * render, SNDFILE *infile, int samplerate, sf_count_t filelen, cairo_surface_t * surface)
 {
 	float ** mag_spec = NULL ; // Indexed by [w][h]
 
-	spectrum *spec ;
-	double max_mag = 0.0 ;
-	int width, height, w, speclen ;
+	spectrum *spec = NULL ;
+	zoom_spectrum *zspec = NULL ;
+	cq_spectrum *cqspec = NULL ;
+	DB_HIST *hist = NULL ;
+	FEATURES *feat = NULL ;
+	STREAM stream = { } ;
+	double max_mag = 0.0, spec_floor_db = render->spec_floor_db ;
+	int width, height, w, speclen, top, lane = 0 ;
 
 	if (render->border)
 	{	width = lrint (cairo_image_surface_get_width (surface) - LEFT_BORDER - RIGHT_BORDER) ;
@@ -760,6 +993,12 @@ render_to_surface (const RENDER * render, SNDFILE *infile, int samplerate, sf_co
 		height = render->height ;
 		}
 
+	/* The waveform lane goes above the spectrogram. */
+	if (render->waveform_height > 0)
+		lane = render->waveform_height + (render->border ? LANE_GAP : 0) ;
+	height -= lane ;
+	top = (render->border ? TOP_BORDER : 0) + lane ;
+
 	if (width < 1)
 	{	printf ("Error : 'width' parameter must be >= %d\n",
 			render->border ? (int) (LEFT_BORDER + RIGHT_BORDER) + 1 : 1) ;
@@ -768,41 +1007,11 @@ render_to_surface (const RENDER * render, SNDFILE *infile, int samplerate, sf_co
 
 	if (height < 1)
 	{	printf ("Error : 'height' parameter must be >= %d\n",
-			render->border ? (int) (TOP_BORDER + BOTTOM_BORDER) + 1 : 1) ;
+			(render->border ? (int) (TOP_BORDER + BOTTOM_BORDER) : 0) + lane + 1) ;
 		exit (1) ;
 		} ;
 
-	/*
-	** Choose a speclen value, the spectrum length.
-	** The FFT window size is twice this.
-	*/
-	if (render->fft_freq != 0.0)
-		/* Choose an FFT window size of 1/fft_freq seconds of audio */
-		speclen = (samplerate / render->fft_freq + 1) / 2 ;
-	else
-		/* Long enough to represent frequencies down to 20Hz. */
-		speclen = height * (samplerate / 20 / height + 1) ;
-
-	/* Find the nearest fast value for the FFT size. */
-	{	int d ;	/* difference */
-
-		for (d = 0 ; /* Will terminate */ ; d++)
-		{	/* Logarithmically, the integer above is closer than
-			** the integer below, so prefer it to the one below.
-			*/
-			if (is_good_speclen (speclen + d))
-			{	speclen += d ;
-				break ;
-				}
-			/* FFT length must also be >= the output height,
-			** otherwise repeated pixel rows occur in the output.
-			*/
-			if (speclen - d >= height && is_good_speclen (speclen - d))
-			{	speclen -= d ;
-				break ;
-				}
-			}
-		}
+	speclen = choose_speclen (render, samplerate, height) ;
 
 	mag_spec = calloc (width, sizeof (float *)) ;
 	if (mag_spec == NULL)
@@ -816,43 +1025,141 @@ render_to_surface (const RENDER * render, SNDFILE *infile, int samplerate, sf_co
 			} ;
 		} ;
 
-	spec = create_spectrum (speclen, render->window_function) ;
+	if (render->zoom)
+	{	double bin_width = render->fft_freq ;
 
-	if (spec == NULL)
+		/* Default to one FFT bin per output pixel. */
+		if (bin_width == 0.0)
+			bin_width = (render->max_freq - render->min_freq) / height ;
+
+		zspec = create_zoom_spectrum (samplerate, render->min_freq, render->max_freq, bin_width, render->window_function) ;
+		if (zspec == NULL)
+			fprintf (stderr, "Warning : frequency band too wide for --zoom, using a full band FFT.\n") ;
+		} ;
+
+	if (render->cqt)
+	{	/* One constant-Q bin per pixel row. */
+		cqspec = create_cq_spectrum (samplerate, render->min_freq, render->max_freq, height, render->window_function) ;
+		if (cqspec == NULL)
+		{	printf ("%s : line %d : create constant-Q kernels failed.\n", __FILE__, __LINE__) ;
+			exit (1) ;
+			} ;
+		} ;
+
+	if (zspec == NULL && cqspec == NULL && (spec = create_spectrum (speclen, render->window_function)) == NULL)
 	{	printf ("%s : line %d : create plan failed.\n", __FILE__, __LINE__) ;
 		exit (1) ;
 		} ;
 
+	if (render->auto_range > 0.0 && (hist = calloc (1, sizeof (DB_HIST))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	if (render->featurespath != NULL)
+		feat = features_open (render->featurespath, speclen, samplerate, spec->window) ;
+
+	/*
+	**	With a waveform lane the file is read once, sequentially, and every
+	**	frame goes to the peak bins as well as to the spectra.
+	*/
+	stream.file = infile ;
+	if (render->waveform_height > 0)
+	{	stream.size = cqspec != NULL ? cqspec->fftlen : 2 * speclen ;
+		if ((stream.data = calloc (stream.size, sizeof (double))) == NULL)
+		{	printf ("%s : Not enough memory.\n", __func__) ;
+			exit (1) ;
+			} ;
+		stream.peaks = peaks_create (width, 1, filelen) ;
+		} ;
+
 	for (w = 0 ; w < width ; w++)
 	{	double single_max ;
 
-		read_mono_audio (infile, filelen, spec->time_domain, 2 * speclen, w, width) ;
+		if (cqspec != NULL)
+		{	int h ;
+
+			read_column (&stream, filelen, cqspec->time_domain, cqspec->fftlen, w, width) ;
+
+			single_max = calc_cq_spectrum (cqspec) ;
+
+			for (h = 0 ; h < height ; h++)
+				mag_spec [w][h] = cqspec->mag_spec [h] ;
+			}
+		else if (zspec != NULL)
+		{	single_max = calc_zoom_spectrum (zspec, infile, filelen, (w * filelen) / width) ;
+
+			interp_spec (mag_spec [w], height, zspec->mag_spec, zspec->fftlen - 1, render, zspec->base_freq, zspec->bin_width) ;
+			}
+		else
+		{	read_column (&stream, filelen, spec->time_domain, 2 * speclen, w, width) ;
+
+			single_max = calc_magnitude_spectrum (spec) ;
+
+			interp_spec (mag_spec [w], height, spec->mag_spec, speclen, render, 0.0, 0.5 * samplerate / speclen) ;
+
+			if (feat != NULL)
+				features_add_column (feat, (double) ((w * filelen) / width) / samplerate, spec->mag_spec) ;
+			} ;
 
-		single_max = calc_magnitude_spectrum (spec) ;
 		max_mag = MAX (max_mag, single_max) ;
 
-		interp_spec (mag_spec [w], height, spec->mag_spec, speclen, render, samplerate) ;
+		if (hist != NULL)
+			hist_add_column (hist, mag_spec [w], height) ;
 		} ;
 
-	destroy_spectrum (spec) ;
+	/* The frames after the last column still belong in the last peak bin. */
+	if (stream.peaks != NULL)
+		stream_read (&stream, stream.data, filelen, 0) ;
+
+	if (feat != NULL)
+		features_close (feat) ;
+
+	if (cqspec != NULL)
+		destroy_cq_spectrum (cqspec) ;
+	else if (zspec != NULL)
+		destroy_zoom_spectrum (zspec) ;
+	else
+		destroy_spectrum (spec) ;
+
+	if (hist != NULL)
+	{	if (max_mag > 0.0)
+			spec_floor_db = hist_floor_db (hist, render->auto_range, max_mag) ;
+		fprintf (stderr, "Dynamic range : %.1f dB (%g%% of values below the floor)\n", -spec_floor_db, render->auto_range) ;
+		free (hist) ;
+		} ;
 
 	if (render->border)
 	{	RECT heat_rect ;
 
 		heat_rect.left = 12 ;
-		heat_rect.top = TOP_BORDER + TOP_BORDER / 2 ;
+		heat_rect.top = top + TOP_BORDER / 2 ;
 		heat_rect.width = 12 ;
 		heat_rect.height = height - TOP_BORDER / 2 ;
 
-		render_spectrogram (surface, render->spec_floor_db, mag_spec, max_mag, LEFT_BORDER, TOP_BORDER, width, height, render->gray_scale) ;
+		render_spectrogram (surface, spec_floor_db, mag_spec, max_mag, LEFT_BORDER, top, width, height, render->gray_scale) ;
 
-		render_heat_map (surface, render->spec_floor_db, &heat_rect, render->gray_scale) ;
+		render_heat_map (surface, spec_floor_db, &heat_rect, render->gray_scale) ;
 
-		render_spect_border (surface, render->filename, LEFT_BORDER, width, filelen / (1.0 * samplerate), TOP_BORDER, height, render->min_freq, render->max_freq, render->log_freq) ;
-		render_heat_border (surface, render->spec_floor_db, &heat_rect) ;
+		render_spect_border (surface, render->filename, LEFT_BORDER, width, filelen / (1.0 * samplerate), TOP_BORDER, top, height, render->min_freq, render->max_freq, render->log_freq) ;
+		render_heat_border (surface, spec_floor_db, &heat_rect) ;
 		}
 	else
-		render_spectrogram (surface, render->spec_floor_db, mag_spec, max_mag, 0, 0, width, height, render->gray_scale) ;
+		render_spectrogram (surface, spec_floor_db, mag_spec, max_mag, 0, top, width, height, render->gray_scale) ;
+
+	if (stream.peaks != NULL)
+	{	RECT lane_rect ;
+
+		lane_rect.left = render->border ? LEFT_BORDER : 0 ;
+		lane_rect.top = render->border ? TOP_BORDER : 0 ;
+		lane_rect.width = width ;
+		lane_rect.height = render->waveform_height ;
+
+		render_waveform_lane (surface, stream.peaks, &lane_rect, render->border) ;
+
+		peaks_destroy (stream.peaks) ;
+		free (stream.data) ;
+		} ;
 
 	for (w = 0 ; w < width ; w++)
 		free (mag_spec [w]) ;
@@ -883,9 +1190,9 @@ render_cairo_surface (const RENDER * render, SNDFILE *infile, int samplerate, sf
 
 	render_to_surface (render, infile, samplerate, filelen, surface) ;
 
-	status = cairo_surface_write_to_png (surface, render->pngfilepath) ;
+	status = image_write (surface, render->pngfilepath, &render->image) ;
 	if (status != CAIRO_STATUS_SUCCESS)
-	{	printf ("Error while creating PNG file : %s\n", cairo_status_to_string (status)) ;
+	{	printf ("Error while creating image file : %s\n", cairo_status_to_string (status)) ;
 		exit (1) ;
 		} ;
 
@@ -894,6 +1201,139 @@ render_cairo_surface (const RENDER * render, SNDFILE *infile, int samplerate, sf
 	return ;
 } /* render_cairo_surface */
 
+static void
+write_stream_image (const RENDER * render, float ** mag_spec, int width, double ref_mag, double spec_floor_db, int tile)
+{	cairo_surface_t * surface ;
+	cairo_status_t status ;
+	char path [1024] ;
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, render->height) ;
+	if (surface == NULL || cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+	{	status = cairo_surface_status (surface) ;
+		printf ("Error while creating surface : %s\n", cairo_status_to_string (status)) ;
+		exit (1) ;
+		} ;
+
+	render_spectrogram (surface, spec_floor_db, mag_spec, ref_mag, 0, 0, width, render->height, render->gray_scale) ;
+
+	if (tile >= 0)
+		numbered_path (path, sizeof (path), render->pngfilepath, tile) ;
+	else
+		snprintf (path, sizeof (path), "%s", render->pngfilepath) ;
+
+	status = image_write (surface, path, &render->image) ;
+	if (status != CAIRO_STATUS_SUCCESS)
+	{	printf ("Error while creating image file : %s\n", cairo_status_to_string (status)) ;
+		exit (1) ;
+		} ;
+
+	cairo_surface_destroy (surface) ;
+} /* write_stream_image */
+
+/*
+**	Read the file sequentially, one column every 1 / px_per_sec seconds,
+**	so it can be a pipe of unknown length. The colours are relative to
+**	full scale rather than to the loudest value. With a width, tiles of
+**	that many columns are written as soon as they are complete, otherwise
+**	one image is written at the end of the stream.
+*/
+static void
+render_stream (const RENDER * render, SNDFILE * infile, int samplerate)
+{	STREAM stream = { } ;
+	spectrum *spec ;
+	DB_HIST *hist = NULL ;
+	FEATURES *feat = NULL ;
+	float ** mag_spec = NULL ;
+	double ref_mag, spec_floor_db = render->spec_floor_db ;
+	sf_count_t column ;
+	int speclen, k, count = 0, capacity = 0, tile = 0 ;
+
+	if (render->height < 1)
+	{	printf ("Error : 'height' parameter must be >= 1\n") ;
+		exit (1) ;
+		} ;
+
+	speclen = choose_speclen (render, samplerate, render->height) ;
+
+	if ((spec = create_spectrum (speclen, render->window_function)) == NULL)
+	{	printf ("%s : line %d : create plan failed.\n", __FILE__, __LINE__) ;
+		exit (1) ;
+		} ;
+
+	ref_mag = full_scale_magnitude (spec) ;
+
+	if (render->featurespath != NULL)
+		feat = features_open (render->featurespath, speclen, samplerate, spec->window) ;
+
+	stream.file = infile ;
+	stream.size = 2 * speclen ;
+	if ((stream.data = calloc (stream.size, sizeof (double))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	if (render->auto_range > 0.0 && (hist = calloc (1, sizeof (DB_HIST))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	for (column = 0 ; ; column++)
+	{	sf_count_t centre = llrint (column * samplerate / render->px_per_sec) ;
+
+		if (! stream_read (&stream, spec->time_domain, centre - speclen, 2 * speclen))
+			break ;
+
+		if (count == capacity)
+		{	float ** new_spec ;
+
+			capacity = render->width > 0 ? render->width : MAX (2 * capacity, 1024) ;
+			if ((new_spec = realloc (mag_spec, capacity * sizeof (float *))) == NULL)
+			{	printf ("%s : Not enough memory.\n", __func__) ;
+				exit (1) ;
+				} ;
+			mag_spec = new_spec ;
+
+			for (k = count ; k < capacity ; k++)
+				if ((mag_spec [k] = calloc (render->height, sizeof (float))) == NULL)
+				{	printf ("%s : Not enough memory.\n", __func__) ;
+					exit (1) ;
+					} ;
+			} ;
+
+		calc_magnitude_spectrum (spec) ;
+		interp_spec (mag_spec [count], render->height, spec->mag_spec, speclen, render, 0.0, 0.5 * samplerate / speclen) ;
+
+		if (feat != NULL)
+			features_add_column (feat, (double) centre / samplerate, spec->mag_spec) ;
+
+		if (hist != NULL)
+			hist_add_column (hist, mag_spec [count], render->height) ;
+
+		if (++ count == render->width)
+		{	write_stream_image (render, mag_spec, count, ref_mag, spec_floor_db, tile ++) ;
+			count = 0 ;
+			} ;
+		} ;
+
+	if (hist != NULL)
+	{	spec_floor_db = hist_floor_db (hist, render->auto_range, ref_mag) ;
+		fprintf (stderr, "Dynamic range : %.1f dB (%g%% of values below the floor)\n", -spec_floor_db, render->auto_range) ;
+		free (hist) ;
+		} ;
+
+	if (count > 0)
+		write_stream_image (render, mag_spec, count, ref_mag, spec_floor_db, render->width > 0 ? tile : -1) ;
+
+	for (k = 0 ; k < capacity ; k++)
+		free (mag_spec [k]) ;
+	free (mag_spec) ;
+	if (feat != NULL)
+		features_close (feat) ;
+
+	free (stream.data) ;
+	destroy_spectrum (spec) ;
+} /* render_stream */
+
 static void
 render_sndfile (RENDER * render)
 {
@@ -906,6 +1346,10 @@ render_sndfile (RENDER * render)
 		exit (1) ;
 		} ;
 
+	/* Constant-Q bins are spaced logarithmically. */
+	if (render->cqt)
+		render->log_freq = true ;
+
 	if (render->max_freq == 0.0)
 		render->max_freq = (double) info.samplerate / 2 ;
 	if (render->min_freq == 0.0 && render->log_freq)
@@ -918,7 +1362,10 @@ render_sndfile (RENDER * render)
 		exit (1) ;
 		} ;
 
-	render_cairo_surface (render, infile, info.samplerate, info.frames) ;
+	if (render->px_per_sec > 0.0)
+		render_stream (render, infile, info.samplerate) ;
+	else
+		render_cairo_surface (render, infile, info.samplerate, info.frames) ;
 
 	sf_close (infile) ;
 
@@ -943,6 +1390,8 @@ usage_exit (const char * argv0, int error)
 	puts (
 		"    Options:\n"
 		"        --dyn-range=<number>   : Dynamic range (default is 180 for 180dB range)\n"
+		"        --auto-range=<number>  : Choose the dynamic range so that this percentage\n"
+		"                                 of the spectrogram is at or below the floor\n"
 		"        --no-border            : Drop the border, scales, heat map and title\n"
 		"        --min-freq=<number>    : Set the minimum frequency in the output\n"
 		"        --max-freq=<number>    : Set the maximum frequency in the output\n"
@@ -953,11 +1402,38 @@ usage_exit (const char * argv0, int error)
 		"                                 improve the temporal definition but decrease the\n"
 		"                                 distinction between the lowest frequencies.\n"
 		"        --log-freq             : Use a logarithmic frequency scale\n"
+		"        --zoom                 : Only analyse the band from --min-freq to\n"
+		"                                 --max-freq, using a decimated zoom FFT. Much\n"
+		"                                 faster for narrow bands. --fft-freq sets the\n"
+		"                                 bin width (default is one bin per pixel).\n"
+		"        --px-per-sec=<number>  : Read the sound file sequentially, which may be\n"
+		"                                 \"-\" for stdin, making this many columns per\n"
+		"                                 second of audio. Colours are relative to full\n"
+		"                                 scale and there is no border. The image is\n"
+		"                                 written in tiles of <img width> columns named\n"
+		"                                 name-0000.png etc, or, if the width is 0, as\n"
+		"                                 one image at the end of the input.\n"
+		"        --features=<file>      : Also write the spectral centroid, flatness,\n"
+		"                                 rolloff, flux and octave band energies of\n"
+		"                                 each column, as CSV or, if the file name ends\n"
+		"                                 in .bin, as rows of float32 values\n"
+		"        --waveform=<number>    : Draw the min/max and RMS waveform of the mono\n"
+		"                                 mix in a lane this many pixels high above the\n"
+		"                                 spectrogram, from the same read of the file\n"
+		"        --cqt                  : Use a constant-Q transform with one bin per\n"
+		"                                 pixel row on a logarithmic frequency scale\n"
 		"        --gray-scale           : Output gray pixels instead of a heat map\n"
 		"        --kaiser               : Use a Kaiser window function (the default)\n"
 		"        --rectangular          : Use a rectangular window function\n"
 		"        --nuttall              : Use a Nuttall window function\n"
 		"        --hann                 : Use a Hann window function\n"
+		"        --format=<name>        : Output format png, ppm, pam or rgba (raw RGBA\n"
+		"                                 rows). The default is to use the extension\n"
+		"                                 of the output file name, \"-\" writes to stdout.\n"
+		"        --compression=<0-9>    : PNG deflate level, 0 stores the image data\n"
+		"                                 uncompressed (default is Cairo's PNG writer)\n"
+		"        --threads=<number>     : Compress PNG row blocks on this many threads,\n"
+		"                                 only with --compression\n"
 		) ;
 
 	exit (error) ;
@@ -966,12 +1442,16 @@ usage_exit (const char * argv0, int error)
 int
 main (int argc, char * argv [])
 {	RENDER render =
-	{	NULL, NULL, NULL,
+	{	NULL, NULL, NULL, NULL,
 		0, 0,				/* width, height */
-		true, false, false, /* border, log_freq, gray_scale */
+		true, false, false, false, false, /* border, log_freq, gray_scale, zoom, cqt */
 		0.0, 0.0, 0.0,		/* {min,max,fft}_freq */
 		KAISER,
-		SPEC_FLOOR_DB
+		SPEC_FLOOR_DB,
+		0.0,				/* auto_range */
+		0.0,				/* px_per_sec */
+		0,					/* waveform_height */
+		{ IMAGE_AUTO, -1, 1 }	/* format, compression, threads */
 		} ;
 	int k ;
 
@@ -980,12 +1460,23 @@ main (int argc, char * argv [])
 
 	for (k = 1 ; k < argc - 4 ; k++)
 	{	double fval ;
+		char name [16] ;
+		int ival ;
 
 		if (sscanf (argv [k], "--dyn-range=%lf", &fval) == 1)
 		{	render.spec_floor_db = -1.0 * fabs (fval) ;
 			continue ;
 			}
 
+		if (sscanf (argv [k], "--auto-range=%lf", &fval) == 1)
+		{	if (fval <= 0.0 || fval >= 100.0)
+			{	printf ("--auto-range must be a percentage between 0 and 100.\n") ;
+				exit (1) ;
+				} ;
+			render.auto_range = fval ;
+			continue ;
+			} ;
+
 		if (strcmp (argv [k], "--no-border") == 0)
 		{	render.border = false ;
 			continue ;
@@ -996,6 +1487,39 @@ main (int argc, char * argv [])
 			continue ;
 			} ;
 
+		if (strcmp (argv [k], "--zoom") == 0)
+		{	render.zoom = true ;
+			continue ;
+			} ;
+
+		if (sscanf (argv [k], "--px-per-sec=%lf", &fval) == 1)
+		{	if (fval <= 0.0)
+			{	printf ("--px-per-sec must be positive.\n") ;
+				exit (1) ;
+				} ;
+			render.px_per_sec = fval ;
+			continue ;
+			} ;
+
+		if (sscanf (argv [k], "--waveform=%d", &ival) == 1)
+		{	if (ival < 1)
+			{	printf ("--waveform must be a positive number of pixels.\n") ;
+				exit (1) ;
+				} ;
+			render.waveform_height = ival ;
+			continue ;
+			} ;
+
+		if (strncmp (argv [k], "--features=", 11) == 0 && argv [k][11] != 0)
+		{	render.featurespath = argv [k] + 11 ;
+			continue ;
+			} ;
+
+		if (strcmp (argv [k], "--cqt") == 0)
+		{	render.cqt = true ;
+			continue ;
+			} ;
+
 		if (sscanf (argv [k], "--min-freq=%lf", &fval) == 1)
 		{	if (fval < 0.0)
 			{	printf ("--min-freq cannot be negative.\n") ;
@@ -1049,20 +1573,86 @@ main (int argc, char * argv [])
 			continue ;
 			} ;
 
+		if (sscanf (argv [k], "--format=%15s", name) == 1)
+		{	if ((ival = image_format_from_name (name)) < 0)
+			{	printf ("--format must be one of png, ppm, pam or rgba.\n") ;
+				exit (1) ;
+				} ;
+			render.image.format = ival ;
+			continue ;
+			} ;
+
+		if (sscanf (argv [k], "--compression=%d", &ival) == 1)
+		{	if (ival < 0 || ival > 9)
+			{	printf ("--compression must be in the range [0, 9].\n") ;
+				exit (1) ;
+				} ;
+			render.image.compression = ival ;
+			continue ;
+			} ;
+
+		if (sscanf (argv [k], "--threads=%d", &ival) == 1)
+		{	if (ival < 1)
+			{	printf ("--threads must be positive.\n") ;
+				exit (1) ;
+				} ;
+			render.image.threads = ival ;
+			continue ;
+			} ;
+
 		printf ("\nError : Bad command line argument '%s'\n", argv [k]) ;
 		usage_exit (argv [0], 1) ;
 		} ;
 
+	if (render.zoom && render.cqt)
+	{	printf ("--zoom and --cqt can not be used together.\n") ;
+		exit (1) ;
+		} ;
+
+	if (render.featurespath != NULL && (render.zoom || render.cqt))
+	{	printf ("--features needs the full band FFT, not --zoom or --cqt.\n") ;
+		exit (1) ;
+		} ;
+
+	if (render.px_per_sec > 0.0 && (render.zoom || render.cqt))
+	{	printf ("--px-per-sec can not be used with --zoom or --cqt.\n") ;
+		exit (1) ;
+		} ;
+
+	if (render.waveform_height > 0 && (render.zoom || render.px_per_sec > 0.0))
+	{	printf ("--waveform can not be used with --zoom or --px-per-sec.\n") ;
+		exit (1) ;
+		} ;
+
+	image_check_options (&render.image) ;
+
 	render.sndfilepath = argv [k] ;
 	render.width = parse_int_or_die (argv [k + 1], "width") ;
 	render.height = parse_int_or_die (argv [k + 2], "height") ;
 	render.pngfilepath = argv [k + 3] ;
 
+	if (render.px_per_sec > 0.0)
+	{	/* Streamed images have no border and the width is the tile width. */
+		render.border = false ;
+
+		if (render.width < 0)
+		{	printf ("Error : 'width' parameter must be >= 0 with --px-per-sec.\n") ;
+			exit (1) ;
+			} ;
+
+		if (render.width > 0 && render.auto_range > 0.0)
+		{	printf ("Error : --auto-range needs a width of 0 with --px-per-sec.\n") ;
+			exit (1) ;
+			} ;
+		} ;
+
 	render.filename = strrchr (render.sndfilepath, '/') ;
 	render.filename = (render.filename != NULL) ? render.filename + 1 : render.sndfilepath ;
 
 	render_sndfile (&render) ;
 
+	free_window_cache () ;
+
 	/* Certain FontConfig objects indirectly referenced via the Cairo
 	 * static data are referenced by integer offsets rather than by
 	 * pointers, so they appear lost to Valgrind unless we call this
@@ -32,11 +32,9 @@ create_spectrum (int speclen, enum WINDOW_FUNCTION window_function)
 	** samples for better time precision, hoping to eliminate artifacts.
 	*/
 	spec->time_domain = calloc (2 * speclen + 1, sizeof (double)) ;
-	spec->window = calloc (2 * speclen, sizeof (double)) ;
 	spec->freq_domain = calloc (2 * speclen, sizeof (double)) ;
 	spec->mag_spec = calloc (speclen + 1, sizeof (double)) ;
 	if (spec->time_domain == NULL
-		|| spec->window == NULL
 		|| spec->freq_domain == NULL
 		|| spec->mag_spec == NULL)
 	{	printf ("%s : Not enough memory.\n", __func__) ;
@@ -50,23 +48,9 @@ create_spectrum (int speclen, enum WINDOW_FUNCTION window_function)
 		exit (1) ;
 		} ;
 
-	switch (spec->wfunc)
-	{	case RECTANGULAR :
-			break ;
-		case KAISER :
-			calc_kaiser_window (spec->window, 2 * speclen, 20.0) ;
-			break ;
-		case NUTTALL:
-			calc_nuttall_window (spec->window, 2 * speclen) ;
-			break ;
-		case HANN :
-			calc_hann_window (spec->window, 2 * speclen) ;
-			break ;
-		default :
-			printf ("Internal error: Unknown window_function.\n") ;
-			free (spec) ;
-			exit (1) ;
-		} ;
+	/* Windows are shared between spectra of the same length. */
+	if (spec->wfunc != RECTANGULAR)
+		spec->window = get_cached_window (spec->wfunc, 2 * speclen, 0.0) ;
 
 	return spec ;
 } /* create_spectrum */
@@ -77,7 +61,6 @@ destroy_spectrum (spectrum * spec)
 {
 	fftw_destroy_plan (spec->plan) ;
 	free (spec->time_domain) ;
-	free (spec->window) ;
 	free (spec->freq_domain) ;
 	free (spec->mag_spec) ;
 	free (spec) ;
@@ -115,3 +98,393 @@ calc_magnitude_spectrum (spectrum * spec)
 
 	return max ;
 } /* calc_magnitude_spectrum */
+
+/*
+**	Zoom spectrum.
+*/
+
+/* Stop band attenuation of the decimating filter, in dB. */
+#define	ZOOM_ATTENUATION	120.0
+
+static int
+good_fft_len (int n)
+{	int k ;
+
+	/* Smallest even length >= n with only 2, 3 and 5 as factors. */
+	for (n += n & 1 ; ; n += 2)
+	{	k = n ;
+		while (k % 2 == 0) k /= 2 ;
+		while (k % 3 == 0) k /= 3 ;
+		while (k % 5 == 0) k /= 5 ;
+		if (k == 1)
+			return n ;
+		} ;
+} /* good_fft_len */
+
+zoom_spectrum *
+create_zoom_spectrum (int samplerate, double min_freq, double max_freq, double bin_width, enum WINDOW_FUNCTION window_function)
+{	zoom_spectrum *zspec ;
+	double *lowpass ;
+	double bandwidth, cutoff, transition, beta, sum, w ;
+	int k, decimation ;
+
+	bandwidth = max_freq - min_freq ;
+
+	/* The decimated rate has to be at least twice the bandwidth so that the
+	** filter's transition band folds outside the band of interest. Below a
+	** decimation of 4 a full band FFT is just as cheap.
+	*/
+	decimation = lrint (floor (samplerate / (2.0 * bandwidth))) ;
+	if (decimation < 4 || bin_width <= 0.0)
+		return NULL ;
+
+	zspec = calloc (1, sizeof (zoom_spectrum)) ;
+	if (zspec == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	zspec->samplerate = samplerate ;
+	zspec->decimation = decimation ;
+	zspec->fftlen = good_fft_len (lrint (ceil (samplerate / (decimation * bin_width)))) ;
+	zspec->bin_width = (double) samplerate / decimation / zspec->fftlen ;
+	zspec->centre_freq = 0.5 * (min_freq + max_freq) ;
+	zspec->base_freq = zspec->centre_freq - (zspec->fftlen / 2) * zspec->bin_width ;
+
+	/* Kaiser windowed sinc, the transition band centred on half the decimated rate. */
+	cutoff = 0.5 / decimation ;
+	transition = (double) samplerate / decimation - bandwidth ;
+	beta = 0.1102 * (ZOOM_ATTENUATION - 8.7) ;
+	zspec->taplen = lrint (ceil ((ZOOM_ATTENUATION - 8.0) / (2.285 * 2.0 * M_PI * transition / samplerate))) | 1 ;
+
+	zspec->taps = calloc (2 * zspec->taplen, sizeof (double)) ;
+	zspec->rotate = calloc (2 * zspec->fftlen, sizeof (double)) ;
+	zspec->input = calloc ((sf_count_t) zspec->fftlen * decimation + zspec->taplen, sizeof (double)) ;
+	zspec->history = calloc (2 * zspec->fftlen, sizeof (double)) ;
+	zspec->mag_spec = calloc (zspec->fftlen, sizeof (double)) ;
+	zspec->time_domain = fftw_malloc (zspec->fftlen * sizeof (fftw_complex)) ;
+	zspec->freq_domain = fftw_malloc (zspec->fftlen * sizeof (fftw_complex)) ;
+	if (zspec->taps == NULL || zspec->rotate == NULL
+		|| zspec->input == NULL || zspec->history == NULL || zspec->mag_spec == NULL
+		|| zspec->time_domain == NULL || zspec->freq_domain == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	zspec->plan = fftw_plan_dft_1d (zspec->fftlen, zspec->time_domain, zspec->freq_domain, FFTW_FORWARD, FFTW_MEASURE) ;
+	if (zspec->plan == NULL)
+	{	printf ("%s:%d : fftw create plan failed.\n", __func__, __LINE__) ;
+		exit (1) ;
+		} ;
+
+	if ((lowpass = calloc (zspec->taplen, sizeof (double))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	calc_kaiser_window (lowpass, zspec->taplen, beta) ;
+
+	sum = 0.0 ;
+	for (k = 0 ; k < zspec->taplen ; k++)
+	{	double t = k - 0.5 * (zspec->taplen - 1) ;
+
+		if (t != 0.0)
+			lowpass [k] *= sin (2.0 * M_PI * cutoff * t) / (M_PI * t) ;
+		else
+			lowpass [k] *= 2.0 * cutoff ;
+		sum += lowpass [k] ;
+		} ;
+
+	/* Tap k multiplies x [n - k], so mixing x [n - k] down by the centre
+	** frequency is exp (-i w (n - k)) = exp (-i w n) * exp (i w k). The first
+	** factor is applied to the decimated samples (zspec->rotate), the second
+	** is folded into the taps.
+	*/
+	w = 2.0 * M_PI * zspec->centre_freq / samplerate ;
+
+	for (k = 0 ; k < zspec->taplen ; k++)
+	{	zspec->taps [2 * k] = lowpass [k] / sum * cos (w * k) ;
+		zspec->taps [2 * k + 1] = lowpass [k] / sum * sin (w * k) ;
+		} ;
+
+	for (k = 0 ; k < zspec->fftlen ; k++)
+	{	zspec->rotate [2 * k] = cos (w * k * decimation) ;
+		zspec->rotate [2 * k + 1] = -sin (w * k * decimation) ;
+		} ;
+
+	free (lowpass) ;
+
+	zspec->window = get_cached_window (window_function, zspec->fftlen, 0.0) ;
+
+	return zspec ;
+} /* create_zoom_spectrum */
+
+void
+destroy_zoom_spectrum (zoom_spectrum * zspec)
+{
+	fftw_destroy_plan (zspec->plan) ;
+	free (zspec->taps) ;
+	free (zspec->rotate) ;
+	free (zspec->input) ;
+	free (zspec->history) ;
+	free (zspec->mag_spec) ;
+	fftw_free (zspec->time_domain) ;
+	fftw_free (zspec->freq_domain) ;
+	free (zspec) ;
+} /* destroy_zoom_spectrum */
+
+/* Position of decimated sample g in the history ring, g may be negative. */
+static inline int
+zoom_ring_index (sf_count_t g, int len)
+{	return ((g % len) + len) % len ;
+} /* zoom_ring_index */
+
+/* Read frames [start, start + len) of the mono mix, zero outside the file. */
+static void
+zoom_read_audio (SNDFILE * file, sf_count_t filelen, double * data, sf_count_t start, sf_count_t len)
+{
+	memset (data, 0, len * sizeof (data [0])) ;
+
+	if (start < 0)
+	{	data -= start ;
+		len += start ;
+		start = 0 ;
+		} ;
+
+	if (len <= 0 || start >= filelen)
+		return ;
+
+	sf_seek (file, start, SEEK_SET) ;
+	sfx_mix_mono_read_double (file, data, MIN (len, filelen - start)) ;
+} /* zoom_read_audio */
+
+double
+calc_zoom_spectrum (zoom_spectrum * zspec, SNDFILE * file, sf_count_t filelen, sf_count_t centre)
+{	sf_count_t first, next, count, g ;
+	double max ;
+	int N, D, L, k, j ;
+
+	N = zspec->fftlen ;
+	D = zspec->decimation ;
+	L = zspec->taplen ;
+
+	/* Decimated sample g is the filter output at frame g * D, delayed by
+	** (L - 1) / 2 frames. Pick the N samples centred on 'centre'.
+	*/
+	first = (centre + (L - 1) / 2) / D - N / 2 ;
+
+	/* Keep whatever overlaps with the previous call. */
+	if (first < zspec->hist_start || first > zspec->hist_end)
+		zspec->hist_start = zspec->hist_end = first ;
+	zspec->hist_start = first ;
+
+	next = zspec->hist_end ;
+	count = first + N - next ;
+
+	if (count > 0)
+	{	zoom_read_audio (file, filelen, zspec->input, next * D - (L - 1), (count - 1) * D + L) ;
+
+		for (g = 0 ; g < count ; g++)
+		{	const double *x = zspec->input + g * D + L - 1 ;
+			double re = 0.0, im = 0.0 ;
+			double *out = zspec->history + 2 * zoom_ring_index (next + g, N) ;
+
+			for (k = 0 ; k < L ; k++)
+			{	re += x [-k] * zspec->taps [2 * k] ;
+				im += x [-k] * zspec->taps [2 * k + 1] ;
+				} ;
+
+			out [0] = re ;
+			out [1] = im ;
+			} ;
+
+		zspec->hist_end = first + N ;
+		} ;
+
+	/* Finish the mixing, window and transform. The phase of the mixing
+	** is restarted at each column which only changes the phase of the
+	** result, not its magnitude.
+	*/
+	for (j = 0 ; j < N ; j++)
+	{	const double *h = zspec->history + 2 * zoom_ring_index (first + j, N) ;
+		const double *r = zspec->rotate + 2 * j ;
+
+		zspec->time_domain [j][0] = (h [0] * r [0] - h [1] * r [1]) * zspec->window [j] ;
+		zspec->time_domain [j][1] = (h [0] * r [1] + h [1] * r [0]) * zspec->window [j] ;
+		} ;
+
+	fftw_execute (zspec->plan) ;
+
+	/* Move the negative frequencies below the positive ones. */
+	max = 0.0 ;
+	for (k = 0 ; k < N ; k++)
+	{	const double *c = zspec->freq_domain [(k + N / 2) % N] ;
+
+		zspec->mag_spec [k] = sqrt (c [0] * c [0] + c [1] * c [1]) ;
+		max = MAX (max, zspec->mag_spec [k]) ;
+		} ;
+
+	return max ;
+} /* calc_zoom_spectrum */
+
+/*
+**	Constant-Q spectrum, using the sparse spectral kernels of
+**	J. C. Brown and M. S. Puckette, "An efficient algorithm for the
+**	calculation of a constant Q transform", JASA 92(5), 1992.
+*/
+
+/* Spectral kernel values below this fraction of the kernel's peak are dropped. */
+#define	CQ_KERNEL_THRESHOLD	1e-4
+
+cq_spectrum *
+create_cq_spectrum (int samplerate, double min_freq, double max_freq, int bins, enum WINDOW_FUNCTION window_function)
+{	cq_spectrum *cqspec ;
+	fftw_complex *temporal, *spectral ;
+	fftw_plan plan ;
+	double bins_per_octave, Q ;
+	int k, total ;
+
+	if (bins < 2 || min_freq <= 0.0 || max_freq <= min_freq)
+		return NULL ;
+
+	cqspec = calloc (1, sizeof (cq_spectrum)) ;
+	if (cqspec == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	bins_per_octave = (bins - 1) / log2 (max_freq / min_freq) ;
+	Q = 1.0 / (pow (2.0, 1.0 / bins_per_octave) - 1.0) ;
+
+	cqspec->bins = bins ;
+	cqspec->min_freq = min_freq ;
+	cqspec->max_freq = max_freq ;
+
+	/* The FFT has to hold the longest kernel, the one for min_freq. */
+	cqspec->fftlen = good_fft_len (lrint (ceil (Q * samplerate / min_freq))) ;
+
+	cqspec->time_domain = calloc (cqspec->fftlen, sizeof (double)) ;
+	cqspec->freq_domain = calloc (cqspec->fftlen, sizeof (double)) ;
+	cqspec->mag_spec = calloc (bins, sizeof (double)) ;
+	cqspec->kernel_start = calloc (bins, sizeof (int)) ;
+	cqspec->kernel_len = calloc (bins, sizeof (int)) ;
+	temporal = fftw_malloc (cqspec->fftlen * sizeof (fftw_complex)) ;
+	spectral = fftw_malloc (cqspec->fftlen * sizeof (fftw_complex)) ;
+	if (cqspec->time_domain == NULL || cqspec->freq_domain == NULL || cqspec->mag_spec == NULL
+		|| cqspec->kernel_start == NULL || cqspec->kernel_len == NULL
+		|| temporal == NULL || spectral == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (1) ;
+		} ;
+
+	cqspec->plan = fftw_plan_r2r_1d (cqspec->fftlen, cqspec->time_domain, cqspec->freq_domain, FFTW_R2HC, FFTW_MEASURE) ;
+	plan = fftw_plan_dft_1d (cqspec->fftlen, temporal, spectral, FFTW_FORWARD, FFTW_ESTIMATE) ;
+	if (cqspec->plan == NULL || plan == NULL)
+	{	printf ("%s:%d : fftw create plan failed.\n", __func__, __LINE__) ;
+		exit (1) ;
+		} ;
+
+	/* Kernels are built one at a time and only the significant, contiguous
+	** range of positive frequency bins around each kernel's peak is kept.
+	*/
+	total = 0 ;
+	for (k = 0 ; k < bins ; k++)
+	{	double freq, peak, *kern, *window ;
+		int len, start, lo, hi, j ;
+
+		freq = min_freq * pow (max_freq / min_freq, (double) k / (bins - 1)) ;
+		len = MIN (lrint (ceil (Q * samplerate / freq)), cqspec->fftlen) ;
+		start = (cqspec->fftlen - len) / 2 ;
+
+		if ((window = calloc (len, sizeof (double))) == NULL)
+		{	printf ("%s : Not enough memory.\n", __func__) ;
+			exit (1) ;
+			} ;
+		calc_window (window, len, window_function, 0.0) ;
+
+		memset (temporal, 0, cqspec->fftlen * sizeof (fftw_complex)) ;
+		for (j = 0 ; j < len ; j++)
+		{	temporal [start + j][0] = window [j] / len * cos (2.0 * M_PI * freq * j / samplerate) ;
+			temporal [start + j][1] = window [j] / len * sin (2.0 * M_PI * freq * j / samplerate) ;
+			} ;
+		free (window) ;
+
+		fftw_execute (plan) ;
+
+		lo = lrint (freq * cqspec->fftlen / samplerate) ;
+		lo = MAX (1, MIN (lo, cqspec->fftlen / 2)) ;
+		peak = hypot (spectral [lo][0], spectral [lo][1]) ;
+
+		for (hi = lo ; hi < cqspec->fftlen / 2 && hypot (spectral [hi + 1][0], spectral [hi + 1][1]) >= CQ_KERNEL_THRESHOLD * peak ; hi++) ;
+		for ( ; lo > 1 && hypot (spectral [lo - 1][0], spectral [lo - 1][1]) >= CQ_KERNEL_THRESHOLD * peak ; lo--) ;
+
+		cqspec->kernel_start [k] = lo ;
+		cqspec->kernel_len [k] = hi - lo + 1 ;
+
+		kern = realloc (cqspec->kernel, 2 * (total + cqspec->kernel_len [k]) * sizeof (double)) ;
+		if (kern == NULL)
+		{	printf ("%s : Not enough memory.\n", __func__) ;
+			exit (1) ;
+			} ;
+		cqspec->kernel = kern ;
+
+		/* Store the complex conjugate, scaled for the inverse transform. */
+		for (j = lo ; j <= hi ; j++)
+		{	kern [2 * total] = spectral [j][0] / cqspec->fftlen ;
+			kern [2 * total + 1] = -spectral [j][1] / cqspec->fftlen ;
+			total ++ ;
+			} ;
+		} ;
+
+	fftw_destroy_plan (plan) ;
+	fftw_free (temporal) ;
+	fftw_free (spectral) ;
+
+	return cqspec ;
+} /* create_cq_spectrum */
+
+void
+destroy_cq_spectrum (cq_spectrum * cqspec)
+{
+	fftw_destroy_plan (cqspec->plan) ;
+	free (cqspec->time_domain) ;
+	free (cqspec->freq_domain) ;
+	free (cqspec->mag_spec) ;
+	free (cqspec->kernel_start) ;
+	free (cqspec->kernel_len) ;
+	free (cqspec->kernel) ;
+	free (cqspec) ;
+} /* destroy_cq_spectrum */
+
+double
+calc_cq_spectrum (cq_spectrum * cqspec)
+{	const double *kern ;
+	double max = 0.0 ;
+	int k, j, N ;
+
+	N = cqspec->fftlen ;
+
+	fftw_execute (cqspec->plan) ;
+
+	/* Each bin is the dot product of the half complex spectrum with its
+	** kernel. All kernel bins are in 1 .. N / 2, so for bin N / 2 of an
+	** even length FFT the imaginary part is zero.
+	*/
+	kern = cqspec->kernel ;
+	for (k = 0 ; k < cqspec->bins ; k++)
+	{	double re = 0.0, im = 0.0 ;
+
+		for (j = cqspec->kernel_start [k] ; j < cqspec->kernel_start [k] + cqspec->kernel_len [k] ; j++, kern += 2)
+		{	double xr = cqspec->freq_domain [j] ;
+			double xi = (2 * j < N) ? cqspec->freq_domain [N - j] : 0.0 ;
+
+			re += xr * kern [0] - xi * kern [1] ;
+			im += xr * kern [1] + xi * kern [0] ;
+			} ;
+
+		cqspec->mag_spec [k] = sqrt (re * re + im * im) ;
+		max = MAX (max, cqspec->mag_spec [k]) ;
+		} ;
+
+	return max ;
+} /* calc_cq_spectrum */
@@ -5,7 +5,7 @@ typedef struct
 	fftw_plan plan ;
 
 	double *time_domain ;
-	double *window ;
+	const double *window ;
 	double *freq_domain ;
 	double *mag_spec ;
 
@@ -18,3 +18,68 @@ spectrum * create_spectrum (int speclen, enum WINDOW_FUNCTION window_function) ;
 void destroy_spectrum (spectrum * spec) ;
 
 double calc_magnitude_spectrum (spectrum * spec) ;
+
+/*
+**	Zoom spectrum of a narrow band.
+**
+**	The audio is mixed down to the centre of the band and low pass filtered
+**	by a single FIR with complex taps, which is only evaluated at every
+**	decimation'th sample. A short complex FFT of the decimated signal then
+**	gives fftlen bins of bin_width Hz, mag_spec [k] being the magnitude at
+**	base_freq + k * bin_width. Decimated samples are kept between calls so
+**	overlapping columns only filter the audio once.
+*/
+
+typedef struct
+{	int fftlen, decimation, taplen ;
+	double samplerate, centre_freq, base_freq, bin_width ;
+	fftw_plan plan ;
+
+	double *taps ;			/* Complex FIR taps, interleaved re/im. */
+	double *rotate ;		/* Complex mixing phase for each decimated sample. */
+	const double *window ;
+	double *input ;			/* Audio for the decimated samples still to compute. */
+	double *history ;		/* Ring of fftlen complex decimated samples. */
+	sf_count_t hist_start, hist_end ;
+
+	fftw_complex *time_domain ;
+	fftw_complex *freq_domain ;
+	double *mag_spec ;
+} zoom_spectrum ;
+
+/* Returns NULL if the band is too wide for zooming to pay off. */
+zoom_spectrum * create_zoom_spectrum (int samplerate, double min_freq, double max_freq, double bin_width, enum WINDOW_FUNCTION window_function) ;
+
+void destroy_zoom_spectrum (zoom_spectrum * zspec) ;
+
+/* Spectrum of the audio centred on frame 'centre' of 'file'. Returns the maximum magnitude. */
+double calc_zoom_spectrum (zoom_spectrum * zspec, SNDFILE * file, sf_count_t filelen, sf_count_t centre) ;
+
+
+/*
+**	Constant-Q spectrum with 'bins' geometrically spaced bins from min_freq
+**	to max_freq. One real FFT of fftlen samples of time_domain is multiplied
+**	by a sparse spectral kernel per bin, built once when it is created.
+**	The input is not windowed, the kernels are.
+*/
+
+typedef struct
+{	int fftlen, bins ;
+	double min_freq, max_freq ;
+	fftw_plan plan ;
+
+	double *time_domain ;
+	double *freq_domain ;
+	double *mag_spec ;
+
+	int *kernel_start ;		/* First FFT bin of each kernel. */
+	int *kernel_len ;
+	double *kernel ;		/* All kernels, complex interleaved re/im. */
+} cq_spectrum ;
+
+cq_spectrum * create_cq_spectrum (int samplerate, double min_freq, double max_freq, int bins, enum WINDOW_FUNCTION window_function) ;
+
+void destroy_cq_spectrum (cq_spectrum * cqspec) ;
+
+/* Transform cqspec->time_domain into cqspec->mag_spec. Returns the maximum magnitude. */
+double calc_cq_spectrum (cq_spectrum * cqspec) ;
@@ -28,10 +28,18 @@
 #include <limits.h>
 #include <libgen.h>
 #include <getopt.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #include <cairo.h>
 
 #include "common.h"
+#include "image.h"
+#include "peaks.h"
+#include "overview.h"
+#include "export.h"
+#include "meter.h"
+#include "loudness.h"
 
 #include "config.h"
 
@@ -41,6 +49,10 @@
 #define TICK_LEN		(6)
 #define TXT_TICK_LEN	(8)
 #define	BORDER_LINE_WIDTH	(1.8)
+#define	WAVE_LINE_WIDTH		(2.0)
+
+/* Horizontal samples per pixel when rasterizing waveform lines. */
+#define	RASTER_SAMPLES		(4)
 
 #define	TITLE_FONT_SIZE		(20.0)
 #define	NORMAL_FONT_SIZE	(12.0)
@@ -50,6 +62,24 @@
 #define	RIGHT_BORDER		(75.0)
 #define	BOTTOM_BORDER		(40.0)
 
+/* Frames read at a time when scanning the file. */
+#define	SCAN_FRAMES			(16384)
+
+/* Most -g <w>x<h>:<file> images one run can draw. */
+#define	MAX_TARGETS			(16)
+
+/* Most bins computed to share exactly between images of different widths. */
+#define	MAX_SHARED_BINS		(1 << 20)
+
+/* Pixels either side of a tile drawn to join its lines up with the next. */
+#define	TILE_OVERLAP		(2)
+
+/* Bins per pixel kept, at least, while reading a stream of unknown length. */
+#define	STREAM_BINS			(8)
+
+/* The loudness lane runs from this many LUFS at the bottom of the plot to 0 LUFS at the top. */
+#define	LOUDNESS_FLOOR		(-60.0)
+
 #define EXIT_FAILURE 1
 
 #define C_COLOUR(X)	(X)->r, (X)->g, (X)->b, (X)->a
@@ -65,18 +95,41 @@ typedef struct AGC
 {	float min, max, rms ;
 } AGC ;
 
+typedef struct
+{	int width, height ;
+	const char *path ;
+} TARGET ;
+
 typedef struct
 {	const char *sndfilepath, *pngfilepath, *filename ;
+	const char *overviewpath ;
+	const char *exportpath ;
+	int samples_per_pixel, export_bits ;
+	double rms_window ;
+	int tile_width ;
+	bool loudness ;
+	const char *loudnesspath ;	/* Where to write the loudness as JSON, NULL to print it. */
+	LOUDNESS *lufs ;		/* The loudness of the window, for the short-term lane. */
+	double fps ;		/* --playhead frames a second, or 0.0 to write the one image. */
+	double start, end ;
+	sf_count_t first, frames ;
 	int width, height, channel_separation ;
 	int channel ;
 	int what ;
 	bool autogain ;
+	float gain ;		/* Used rather than working out the gain if not 0.0. */
+	int skip ;			/* Bins drawn left of an image without a border, to join up tiles. */
 	bool border, geometry_no_border, logscale, rectified ;
-	COLOUR c_fg, c_rms, c_bg, c_ann, c_bbg, c_cl ;
+	COLOUR c_fg, c_rms, c_bg, c_ann, c_bbg, c_cl, c_loud, c_head, c_played ;
 	int tc_num, tc_den ;
 	double tc_off ;
 	bool parse_bwf ;
 	double border_width ;
+	cairo_font_face_t *font ;	/* Made once and shared by every image. */
+	cairo_surface_t **scratch ;	/* A surface a batch worker keeps from job to job, or NULL. */
+	IMAGE_OPTIONS image ;
+	TARGET target [MAX_TARGETS] ;
+	int targets ;
 } RENDER ;
 
 enum WHAT { PEAK = 1, RMS = 2 } ;
@@ -99,152 +152,392 @@ set_colour (COLOUR * c, int h)
 	c->b = ((h) & 0xff) / 255.0 ;
 } /* set_colour */
 
-/* copied from ardour3 */
-static inline float
-_log_meter (float power, double lower_db, double upper_db, double non_linearity)
+static void
+draw_cairo_line (cairo_t* cr, DRECT *pts, const COLOUR *c)
 {
-	return (power < lower_db ? 0.0 : pow ((power - lower_db) / (upper_db - lower_db), non_linearity)) ;
+	cairo_set_source_rgba (cr, C_COLOUR (c)) ;
+	cairo_move_to (cr, pts->x1, pts->y1) ;
+	cairo_line_to (cr, pts->x2, pts->y2) ;
+	cairo_stroke (cr) ;
 }
 
-static inline float
-alt_log_meter (float power)
+/*
+**	The waveform lines are drawn straight into the pixels of an ARGB32
+**	surface rather than one cairo_stroke () each. A line is the rectangle
+**	Cairo would stroke with butt caps, and each pixel is blended with the
+**	fraction of it the rectangle covers, measured along RASTER_SAMPLES
+**	vertical lines through the pixel.
+*/
+
+typedef struct
+{	unsigned char *data ;
+	int width, height, stride ;
+	float *cover ;
+} RASTER ;
+
+static bool
+raster_open (RASTER * raster, cairo_surface_t * surface)
 {
-	return _log_meter (power, -192.0, 0.0, 8.0) ;
-}
+	memset (raster, 0, sizeof (RASTER)) ;
 
-static inline float coefficient_to_dB (float coeff) {
-	return 20.0f * log10 (coeff) ;
-}
-/* end of ardour copy */
+	if (cairo_image_surface_get_format (surface) != CAIRO_FORMAT_ARGB32)
+		return false ;
 
-#ifdef EQUAL_VSPACE_LOG_TICKS
-static inline float dB_to_coefficient (float dB) {
-	return dB > -318.8f ? pow (10.0f, dB * 0.05f) : 0.0f ;
-}
+	cairo_surface_flush (surface) ;
 
-static inline float
-inv_log_meter (float power)
-{
-	return (power < 0.00000000026 ? -192.0 : (pow (power, 0.125) * 192.0) -192.0) ;
-}
-#endif
+	raster->data = cairo_image_surface_get_data (surface) ;
+	raster->width = cairo_image_surface_get_width (surface) ;
+	raster->height = cairo_image_surface_get_height (surface) ;
+	raster->stride = cairo_image_surface_get_stride (surface) ;
+
+	if (raster->data == NULL || (raster->cover = calloc (raster->height, sizeof (float))) == NULL)
+	{	raster->data = NULL ;
+		return false ;
+		} ;
+
+	return true ;
+} /* raster_open */
 
 static void
-draw_cairo_line (cairo_t* cr, DRECT *pts, const COLOUR *c)
+raster_close (RASTER * raster, cairo_surface_t * surface)
 {
-	cairo_set_source_rgba (cr, C_COLOUR (c)) ;
-	cairo_move_to (cr, pts->x1, pts->y1) ;
-	cairo_line_to (cr, pts->x2, pts->y2) ;
-	cairo_stroke (cr) ;
-}
+	if (raster->data == NULL)
+		return ;
+
+	free (raster->cover) ;
+	cairo_surface_mark_dirty (surface) ;
+	raster->data = NULL ;
+} /* raster_close */
+
+/* Cairo's OVER operator on a premultiplied pixel. */
+static inline void
+blend_pixel (uint32_t * pixel, const COLOUR * c, double cover)
+{	double a = c->a * cover, keep = 1.0 - a ;
+	uint32_t p = *pixel ;
+
+	*pixel = (lrint (255.0 * a + (p >> 24) * keep) << 24)
+			| (lrint (255.0 * c->r * a + ((p >> 16) & 0xff) * keep) << 16)
+			| (lrint (255.0 * c->g * a + ((p >> 8) & 0xff) * keep) << 8)
+			| lrint (255.0 * c->b * a + (p & 0xff) * keep) ;
+} /* blend_pixel */
 
 static void
-calc_peak (SNDFILE *infile, SF_INFO *info, double width, int channel, AGC *agc)
-{
-	int x = 0 ;
-	float s_min, s_max, s_rms ;
-	int channels ;
-	long frames_per_buf, buffer_len ;
+raster_line (RASTER * raster, const DRECT * pts, double width, const COLOUR * c)
+{	double dx = pts->x2 - pts->x1, dy = pts->y2 - pts->y1 ;
+	double len = sqrt (dx * dx + dy * dy) ;
+	double qx [4], qy [4], xmin, xmax, ymin, ymax, nx, ny ;
+	int k, s, x, y, x0, x1, y0, y1 ;
+
+	/* A zero length line with butt caps draws nothing. */
+	if (len <= 0.0)
+		return ;
 
-	const float frames_per_bin = info->frames / (float) width ;
-	const long max_frames_per_bin = ceilf (frames_per_bin) ;
-	float* data ;
-	long f_offset = 0 ;
+	nx = -0.5 * width * dy / len ;
+	ny = 0.5 * width * dx / len ;
+
+	qx [0] = pts->x1 + nx ; qy [0] = pts->y1 + ny ;
+	qx [1] = pts->x2 + nx ; qy [1] = pts->y2 + ny ;
+	qx [2] = pts->x2 - nx ; qy [2] = pts->y2 - ny ;
+	qx [3] = pts->x1 - nx ; qy [3] = pts->y1 - ny ;
+
+	xmin = xmax = qx [0] ;
+	ymin = ymax = qy [0] ;
+	for (k = 1 ; k < 4 ; k++)
+	{	xmin = MIN (xmin, qx [k]) ;
+		xmax = MAX (xmax, qx [k]) ;
+		ymin = MIN (ymin, qy [k]) ;
+		ymax = MAX (ymax, qy [k]) ;
+		} ;
 
-	if (channel < 0 || channel > info->channels)
-	{	printf ("invalid channel\n") ;
+	x0 = MAX (0, (int) floor (xmin)) ;
+	x1 = MIN (raster->width, (int) ceil (xmax)) ;
+	y0 = MAX (0, (int) floor (ymin)) ;
+	y1 = MIN (raster->height, (int) ceil (ymax)) ;
+	if (x0 >= x1 || y0 >= y1)
 		return ;
+
+	for (x = x0 ; x < x1 ; x++)
+	{	for (y = y0 ; y < y1 ; y++)
+			raster->cover [y] = 0.0 ;
+
+		for (s = 0 ; s < RASTER_SAMPLES ; s++)
+		{	double sx = x + (s + 0.5) / RASTER_SAMPLES, top = HUGE_VAL, bottom = -HUGE_VAL ;
+
+			/* Where the vertical line at sx enters and leaves the rectangle. */
+			for (k = 0 ; k < 4 ; k++)
+			{	double ax = qx [k], ay = qy [k], bx = qx [(k + 1) % 4], by = qy [(k + 1) % 4], ey ;
+
+				if (sx < MIN (ax, bx) || sx > MAX (ax, bx))
+					continue ;
+
+				ey = (ax == bx) ? MIN (ay, by) : ay + (by - ay) * (sx - ax) / (bx - ax) ;
+				top = MIN (top, ey) ;
+				bottom = MAX (bottom, (ax == bx) ? MAX (ay, by) : ey) ;
+				} ;
+
+			top = MAX (top, y0) ;
+			bottom = MIN (bottom, y1) ;
+			if (top >= bottom)
+				continue ;
+
+			for (y = (int) floor (top) ; y < bottom ; y++)
+				raster->cover [y] += (MIN (y + 1.0, bottom) - MAX (1.0 * y, top)) / RASTER_SAMPLES ;
+			} ;
+
+		for (y = y0 ; y < y1 ; y++)
+			if (raster->cover [y] > 0.0)
+				blend_pixel ((uint32_t *) (raster->data + y * raster->stride) + x, c, MIN (raster->cover [y], 1.0)) ;
+		} ;
+} /* raster_line */
+
+static void
+draw_line (cairo_t * cr, RASTER * raster, DRECT * pts, const COLOUR * c)
+{
+	if (raster->data != NULL)
+		raster_line (raster, pts, WAVE_LINE_WIDTH, c) ;
+	else
+		draw_cairo_line (cr, pts, c) ;
+} /* draw_line */
+
+typedef struct
+{	SNDFILE *file ;
+	PEAKS *peaks ;
+	RMS_WINDOW *rms ;
+	LOUDNESS *loudness ;	/* This run's part of the loudness, if it is being measured. */
+	bool shorts ;		/* Read the samples as shorts rather than floats. */
+	bool started ;		/* Running on its own thread, so it must be joined. */
+	sf_count_t first, start, end ;
+} SCAN_WORKER ;
+
+/* Whether sf_readf_short () gives the samples of the file as they are. */
+static bool
+short_samples (const SF_INFO *info)
+{
+	switch (info->format & SF_FORMAT_SUBMASK)
+	{	case SF_FORMAT_PCM_S8 :
+		case SF_FORMAT_PCM_U8 :
+		case SF_FORMAT_PCM_16 :
+			return true ;
+
+		default :
+			break ;
 		} ;
 
-	data = malloc (sizeof (float) * max_frames_per_bin * info->channels) ;
+	return false ;
+} /* short_samples */
+
+/* Bin frames [start, end) of the window beginning at frame first of the file. */
+static void *
+scan_worker (void * arg)
+{	SCAN_WORKER *worker = arg ;
+	float *data ;
+	sf_count_t pos, skip, count ;
+
+	data = malloc (sizeof (float) * SCAN_FRAMES * worker->peaks->channels) ;
 	if (!data)
 	{	printf ("out of memory.\n") ;
-		return ;
+		exit (EXIT_FAILURE) ;
 		} ;
 
-	sf_seek (infile, 0, SEEK_SET) ;
+	/* The frames before the run only go through the RMS window and the loudness filters, if any. */
+	skip = worker->rms != NULL ? worker->rms->length : 0 ;
+	if (worker->loudness != NULL)
+		skip = MAX (skip, loudness_preroll (worker->loudness)) ;
+	skip = MIN (skip, worker->first + worker->start) ;
+	if (sf_seek (worker->file, worker->first + worker->start - skip, SEEK_SET) < 0)
+	{	/* Read up to the run if the file cannot seek. */
+		skip = worker->first + worker->start ;
+		} ;
 
-	channels = (channel > 0) ? 1 : info->channels ;
-	s_min = 1.0 ; s_max = -1.0 ; s_rms = 0.0 ;
+	while (skip > 0 && (count = sf_readf_float (worker->file, data, MIN (SCAN_FRAMES, skip))) > 0)
+	{	if (worker->rms != NULL)
+			rms_window_add (worker->rms, data, count) ;
+		if (worker->loudness != NULL)
+			loudness_add (worker->loudness, worker->first + worker->start - skip, data, count) ;
+		skip -= count ;
+		} ;
 
-	frames_per_buf = floorf (frames_per_bin) ;
-	buffer_len = frames_per_buf * info->channels ;
+	pos = worker->start ;
+	while (worker->shorts && pos < worker->end
+			&& (count = sf_readf_short (worker->file, (short *) data, MIN (SCAN_FRAMES, worker->end - pos))) > 0)
+	{	peaks_add_short (worker->peaks, pos, (short *) data, count) ;
+		pos += count ;
+		} ;
 
-	while ((sf_read_float (infile, data, buffer_len)) > 0)
-	{	int frame ;
-		float min, max, rms ;
-		min = 1.0 ; max = -1.0 ; rms = 0.0 ;
-		for (frame = 0 ; frame < frames_per_buf ; frame++)
-		{	int ch ;
-			for (ch = 0 ; ch < info->channels ; ch++)
-			{	if (channel > 0 && ch + 1 != channel)
-					continue ;
-				if (frame * info->channels + ch > buffer_len)
-				{	fprintf (stderr, "index error!\n") ;
-					break ;
-					} ;
-				{
-					const float sample_val = data [frame * info->channels + ch] ;
-					max = MAX (max, sample_val) ;
-					min = MIN (min, sample_val) ;
-					rms += (sample_val * sample_val) ;
-					} ;
-				} ;
+	while (! worker->shorts && pos < worker->end
+			&& (count = sf_readf_float (worker->file, data, MIN (SCAN_FRAMES, worker->end - pos))) > 0)
+	{	peaks_add_float (worker->peaks, pos, data, count) ;
+		if (worker->rms != NULL)
+			peaks_add_rms (worker->peaks, worker->rms, pos, data, count) ;
+		if (worker->loudness != NULL)
+			loudness_add (worker->loudness, worker->first + pos, data, count) ;
+		pos += count ;
+		} ;
+
+	free (data) ;
+	return NULL ;
+} /* scan_worker */
+
+/*
+**	Read the window once, binning the min, max and RMS of every channel
+**	so that the gain and all the waveforms come from memory. The bins
+**	split frames frames, which may run past the end of the window.
+**
+**	With more than one thread a seekable file is split into runs of whole
+**	bins, each read through its own handle, so no two threads ever touch
+**	the same bin.
+**
+**	If loudness is not NULL each run measures its part of the loudness as
+**	well, and the parts are merged into it.
+*/
+static PEAKS *
+scan_peaks (const RENDER *render, SNDFILE *infile, const SF_INFO *info, int width, sf_count_t frames, LOUDNESS *loudness)
+{
+	PEAKS *peaks ;
+	SCAN_WORKER *workers ;
+	pthread_t *tids ;
+	int k, threads ;
+
+	peaks = peaks_create (width, info->channels, frames) ;
+	if (render->rms_window > 0.0)
+		peaks->rms_window = MAX (1, lrint (render->rms_window * info->samplerate / 1000.0)) ;
+
+	threads = info->seekable ? MIN (MAX (render->image.threads, 1), width) : 1 ;
+
+	workers = calloc (threads, sizeof (SCAN_WORKER)) ;
+	tids = calloc (threads, sizeof (pthread_t)) ;
+	if (workers == NULL || tids == NULL)
+	{	printf ("out of memory.\n") ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	/* The calling thread reads the first run through infile. */
+	workers [0].file = infile ;
+	for (k = 1 ; k < threads ; k++)
+	{	SF_INFO tmpinfo = { } ;
+
+		if ((workers [k].file = sf_open (render->sndfilepath, SFM_READ, &tmpinfo)) == NULL)
+		{	threads = k ;
+			break ;
 			} ;
+		} ;
 
-		/* TODO: use a sliding window for RMS - independent of buffer_len */
-		rms /= (frames_per_buf * channels) ;
-		rms = sqrt (rms) ;
+	for (k = 0 ; k < threads ; k++)
+	{	workers [k].peaks = peaks ;
+		workers [k].first = render->first ;
+		if (peaks->rms_window > 0)
+			workers [k].rms = rms_window_create (info->channels, peaks->rms_window) ;
+		workers [k].start = peaks_edge (peaks, (int) (((int64_t) k * width) / threads)) ;
+		workers [k].end = MIN (render->frames, peaks_edge (peaks, (int) (((int64_t) (k + 1) * width) / threads))) ;
+		if (loudness != NULL)
+			workers [k].loudness = loudness_part (loudness, render->first + workers [k].start) ;
+		/* 16 bit PCM read as shorts is half the memory traffic of floats. */
+		workers [k].shorts = workers [k].rms == NULL && workers [k].loudness == NULL && short_samples (info) ;
+		} ;
 
-		if (min < s_min) s_min = min ;
-		if (max > s_max) s_max = max ;
-		if (rms > s_rms) s_rms = rms ;
+	for (k = 1 ; k < threads ; k++)
+	{	workers [k].started = pthread_create (&tids [k], NULL, scan_worker, &workers [k]) == 0 ;
+		/* Fall back to doing that run here. */
+		if (! workers [k].started)
+			scan_worker (&workers [k]) ;
+		} ;
+
+	scan_worker (&workers [0]) ;
+
+	for (k = 1 ; k < threads ; k++)
+	{	if (workers [k].started)
+			pthread_join (tids [k], NULL) ;
+		sf_close (workers [k].file) ;
+		} ;
+
+	for (k = 0 ; k < threads ; k++)
+	{	if (workers [k].rms != NULL)
+			rms_window_destroy (workers [k].rms) ;
+		if (workers [k].loudness != NULL)
+		{	loudness_merge (loudness, workers [k].loudness) ;
+			loudness_destroy (workers [k].loudness) ;
+			} ;
+		} ;
+
+	free (workers) ;
+	free (tids) ;
+	return peaks ;
+} /* scan_peaks */
+
+/*
+**	Bin the file from its overview, first making or remaking the overview
+**	if it is missing or stale. Returns NULL if the bins are too narrow for
+**	the overview, which is checked first so that the file is not read for
+**	an overview that could not be used.
+*/
+static PEAKS *
+overview_peaks (const RENDER *render, SNDFILE *infile, const SF_INFO *info, int width)
+{
+	PEAKS *peaks ;
+
+	if (info->frames / width < OVERVIEW_BLOCK)
+		return NULL ;
+
+	if (! overview_valid (render->overviewpath, render->sndfilepath)
+			&& ! overview_create (render->overviewpath, render->sndfilepath, infile, info))
+		return NULL ;
+
+	peaks = peaks_create (width, info->channels, info->frames) ;
+
+	if (overview_read_peaks (render->overviewpath, peaks))
+		return peaks ;
+
+	peaks_destroy (peaks) ;
+	return NULL ;
+} /* overview_peaks */
+
+static void
+calc_peak (const PEAKS *peaks, int channel, AGC *agc)
+{
+	int x ;
+	float s_min, s_max, s_rms ;
+
+	if (channel < 0 || channel > peaks->channels)
+	{	fprintf (stderr, "%s : invalid channel %d.\n", __func__, channel) ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	s_min = 1.0 ; s_max = -1.0 ; s_rms = 0.0 ;
 
-		x++ ;
-		if (x > width) break ;
+	for (x = 0 ; x < peaks->bins ; x++)
+	{	PEAK_BIN bin ;
+		float rms ;
 
-		f_offset += frames_per_buf ;
-		frames_per_buf = floorf ((x + 1) * frames_per_bin) - f_offset ;
-		buffer_len = frames_per_buf * info->channels ;
+		peaks_get (peaks, channel - 1, x, &bin) ;
+		rms = peaks_rms (peaks, &bin) ;
+
+		if (bin.min < s_min) s_min = bin.min ;
+		if (bin.max > s_max) s_max = bin.max ;
+		if (rms > s_rms) s_rms = rms ;
 		} ;
 
 	agc->min = s_min ;
 	agc->max = s_max ;
 	agc->rms = s_rms ;
-	free (data) ;
 } /* calc_peak */
 
 static void
-render_waveform (cairo_surface_t * surface, RENDER *render, SNDFILE *infile, SF_INFO *info, double left, double top, double width, double height, int channel, float gain)
+render_waveform (cairo_surface_t * surface, RENDER *render, const PEAKS *peaks, double left, double top, double width, double height, int channel, float gain)
 {
 	cairo_t * cr ;
+	RASTER raster ;
 
 	float pmin = 0 ;
 	float pmax = 0 ;
 	float prms = 0 ;
 
-	int x = 0 ;
-	int channels ;
-	long frames_per_buf, buffer_len ;
-
-	const float frames_per_bin = info->frames / (float) width ;
-	const long max_frames_per_bin = 1 + ceilf (frames_per_bin) ;
-	float* data ;
-	long f_offset = 0 ;
+	int x ;
 
-	if (channel < 0 || channel > info->channels)
-	{	printf ("invalid channel\n") ;
-		return ;
-		} ;
-
-	data = malloc (sizeof (float) * max_frames_per_bin * info->channels) ;
-	if (!data)
-	{	printf ("out of memory.\n") ;
-		return ;
+	if (channel < 0 || channel > peaks->channels)
+	{	fprintf (stderr, "%s : invalid channel %d.\n", __func__, channel) ;
+		exit (EXIT_FAILURE) ;
 		} ;
 
-	sf_seek (infile, 0, SEEK_SET) ;
-
 	cr = cairo_create (surface) ;
 	cairo_set_line_width (cr, render->border_width) ;
 	cairo_rectangle (cr, left, top, width, height) ;
@@ -252,39 +545,19 @@ render_waveform (cairo_surface_t * surface, RENDER *render, SNDFILE *infile, SF_
 	cairo_set_source_rgba (cr, C_COLOUR (&render->c_bg)) ;
 	cairo_fill (cr) ;
 
-	cairo_set_line_width (cr, 2.0) ;
-
-	channels = (channel > 0) ? 1 : info->channels ;
-	frames_per_buf = floorf (frames_per_bin) ;
-	buffer_len = frames_per_buf * info->channels ;
+	cairo_set_line_width (cr, WAVE_LINE_WIDTH) ;
+	raster_open (&raster, surface) ;
 
-	while ((sf_read_float (infile, data, buffer_len)) > 0)
-	{	int frame ;
+	for (x = 0 ; x < peaks->bins ; x++)
+	{	PEAK_BIN bin ;
 		float min, max, rms ;
 		double yoff ;
 
-		min = 1.0 ; max = -1.0 ; rms = 0.0 ;
-
-		for (frame = 0 ; frame < frames_per_buf ; frame++)
-		{	int ch ;
-			for (ch = 0 ; ch < info->channels ; ch++)
-			{	if (channel > 0 && ch + 1 != channel)
-					continue ;
-				if (frame * info->channels + ch > buffer_len)
-				{	fprintf (stderr, "index error!\n") ;
-					break ;
-					} ;
-				{
-					const float sample_val = data [frame * info->channels + ch] ;
-					max = MAX (max, sample_val) ;
-					min = MIN (min, sample_val) ;
-					rms += (sample_val * sample_val) ;
-					} ;
-				} ;
-			} ;
+		peaks_get (peaks, channel - 1, x, &bin) ;
+		min = bin.min ;
+		max = bin.max ;
+		rms = peaks_rms (peaks, &bin) ;
 
-		rms /= frames_per_buf * channels ;
-		rms = sqrt (rms) ;
 		if (gain != 1.0)
 		{	min *= gain ;
 			max *= gain ;
@@ -293,16 +566,16 @@ render_waveform (cairo_surface_t * surface, RENDER *render, SNDFILE *infile, SF_
 
 		if (render->logscale)
 		{	if (max > 0)
-				max = alt_log_meter (coefficient_to_dB (max)) ;
+				max = meter_deflection (max) ;
 			else
-				max = -alt_log_meter (coefficient_to_dB (-max)) ;
+				max = -meter_deflection (-max) ;
 
 			if (min > 0)
-				min = alt_log_meter (coefficient_to_dB (min)) ;
+				min = meter_deflection (min) ;
 			else
-				min = -alt_log_meter (coefficient_to_dB (-min)) ;
+				min = -meter_deflection (-min) ;
 
-			rms = alt_log_meter (coefficient_to_dB (rms)) ;
+			rms = meter_deflection (rms) ;
 			} ;
 
 		if (render->rectified)
@@ -324,12 +597,12 @@ render_waveform (cairo_surface_t * surface, RENDER *render, SNDFILE *infile, SF_
 			if (render->rectified)
 			{
 				DRECT pts2 = { left + x, top + yoff - MIN (min, pmin), left + x, top + yoff } ;
-				draw_cairo_line (cr, &pts2, &render->c_fg) ;
+				draw_line (cr, &raster, &pts2, &render->c_fg) ;
 				}
 			else
 			{
 				DRECT pts2 = { left + x, top + yoff - MAX (pmin, min), left + x, top + yoff - MIN (pmax, max) } ;
-				draw_cairo_line (cr, &pts2, &render->c_fg) ;
+				draw_line (cr, &raster, &pts2, &render->c_fg) ;
 				}
 			}
 
@@ -338,12 +611,12 @@ render_waveform (cairo_surface_t * surface, RENDER *render, SNDFILE *infile, SF_
 			if (render->rectified)
 			{
 				DRECT pts2 = { left + x, top + yoff - MIN (prms, rms), left + x, top + yoff } ;
-				draw_cairo_line (cr, &pts2, &render->c_rms) ;
+				draw_line (cr, &raster, &pts2, &render->c_rms) ;
 				}
 			else
 			{
 				DRECT pts2 = { left + x, top + yoff - MIN (prms, rms), left + x, top + yoff + MIN (prms, rms) } ;
-				draw_cairo_line (cr, &pts2, &render->c_rms) ;
+				draw_line (cr, &raster, &pts2, &render->c_rms) ;
 				}
 			}
 
@@ -351,39 +624,33 @@ render_waveform (cairo_surface_t * surface, RENDER *render, SNDFILE *infile, SF_
 		if (render->what & RMS)
 		{
 			DRECT pts0 = { left + x - 0.5, top + yoff - prms, left + x + 0.5, top + yoff - rms } ;
-			draw_cairo_line (cr, &pts0, &render->c_rms) ;
+			draw_line (cr, &raster, &pts0, &render->c_rms) ;
 
 			if (!render->rectified)
 			{
 				DRECT pts1 = { left + x - 0.5, top + yoff + prms, left + x + 0.5, top + yoff + rms } ;
-				draw_cairo_line (cr, &pts1, &render->c_rms) ;
+				draw_line (cr, &raster, &pts1, &render->c_rms) ;
 				}
 			} ;
 
 		if (render->what & PEAK)
 		{
 			DRECT pts0 = { left + x - 0.5, top + yoff - pmin, left + x + 0.5, top + yoff - min } ;
-			draw_cairo_line (cr, &pts0, &render->c_fg) ;
+			draw_line (cr, &raster, &pts0, &render->c_fg) ;
 			if (!render->rectified)
 			{
 				DRECT pts1 = { left + x - 0.5, top + yoff - pmax, left + x + 0.5, top + yoff - max } ;
-				draw_cairo_line (cr, &pts1, &render->c_fg) ;
+				draw_line (cr, &raster, &pts1, &render->c_fg) ;
 				}
 			}
 
 		pmin = min ;
 		pmax = max ;
 		prms = rms ;
-
-		x++ ;
-		if (x > width) break ;
-
-		f_offset += frames_per_buf ;
-		frames_per_buf = floorf ((x + 1) * frames_per_bin) - f_offset ;
-		frames_per_buf = frames_per_buf > max_frames_per_bin ? max_frames_per_bin : frames_per_buf ;
-		buffer_len = frames_per_buf * info->channels ;
 		} ;
 
+	raster_close (&raster, surface) ;
+
 	if (!render->rectified)		// center line
 	{	DRECT pts = { left, top + (0.5 * height) - 0.5, left + width, top + (0.5 * height) + 0.5 } ;
 		cairo_set_line_width (cr, BORDER_LINE_WIDTH) ;
@@ -392,9 +659,41 @@ render_waveform (cairo_surface_t * surface, RENDER *render, SNDFILE *infile, SF_
 
 	cairo_surface_mark_dirty (surface) ;
 	cairo_destroy (cr) ;
-	free (data) ;
 } /* render_waveform */
 
+/*
+**	The short-term loudness up to the end of each pixel, as a line over the
+**	plot from LOUDNESS_FLOOR LUFS at the bottom to 0 LUFS at the top.
+*/
+static void
+render_loudness (cairo_surface_t * surface, const RENDER * render, const PEAKS * peaks, double left, double top, double width, double height)
+{	cairo_t *cr ;
+	sf_count_t first ;
+	int x ;
+
+	cr = cairo_create (surface) ;
+	cairo_rectangle (cr, left + render->skip, top, width - render->skip, height) ;
+	cairo_clip (cr) ;
+
+	/* The frame bin 0 starts at, which for a tile is skip pixels before it. */
+	first = render->first - peaks_edge (peaks, render->skip) ;
+
+	for (x = 0 ; x < peaks->bins ; x++)
+	{	double level = loudness_short_term (render->lufs, first + peaks_edge (peaks, x + 1) - 1) ;
+		double y = top + height * MAX (0.0, MIN (1.0, level / LOUDNESS_FLOOR)) ;
+
+		if (x == 0)
+			cairo_move_to (cr, left + x, y) ;
+		else
+			cairo_line_to (cr, left + x, y) ;
+		} ;
+
+	cairo_set_line_width (cr, WAVE_LINE_WIDTH) ;
+	cairo_set_source_rgba (cr, C_COLOUR (&render->c_loud)) ;
+	cairo_stroke (cr) ;
+	cairo_destroy (cr) ;
+} /* render_loudness */
+
 static inline void
 x_line (cairo_t * cr, double x, double y, double len)
 {	cairo_move_to (cr, x, y) ;
@@ -454,6 +753,37 @@ calculate_ticks (double max, double distance, TICKS * ticks)
 	return divisions + 1 ;
 } /* calculate_ticks */
 
+/*
+**	Ticks for the time axis from start to start + length. A window into
+**	the file gets the spacing calculate_ticks () gives for its length,
+**	rounded up to 1, 2 or 5 times a power of ten, and ticks on whole
+**	multiples of that so that the labels are round.
+*/
+static inline int
+calculate_time_ticks (double start, double length, double distance, TICKS * ticks)
+{	double step, decade, value ;
+	int k, tick_count ;
+
+	tick_count = calculate_ticks (length, distance, ticks) ;
+	if (start == 0.0 || tick_count < 2)
+		return tick_count ;
+
+	step = ticks->value [1] ;
+	decade = pow (10.0, floor (log10 (step))) ;
+	step /= decade ;
+	step = decade * (step <= 1.0 ? 1.0 : step <= 2.0 ? 2.0 : step <= 5.0 ? 5.0 : 10.0) ;
+
+	value = ceil (start / step - 1e-9) * step ;
+
+	for (k = 0 ; k < ARRAY_LEN (ticks->value) && value <= start + length * (1.0 + 1e-9) ; k++)
+	{	ticks->value [k] = value ;
+		ticks->distance [k] = distance * (value - start) / length ;
+		value += step ;
+		} ;
+
+	return k ;
+} /* calculate_time_ticks */
+
 static inline int
 calculate_log_ticks (bool rect, double distance, float gain, TICKS * ticks)
 {	int cnt, i ;
@@ -463,9 +793,9 @@ calculate_log_ticks (bool rect, double distance, float gain, TICKS * ticks)
 	{	double v = ticks->value [i] ;
 		if (!rect) v -= 1.0 ;
 		if (v >= 0)
-			v = (dB_to_coefficient (inv_log_meter (v))) ;
+			v = meter_coefficient (v) ;
 		else
-			v = - (dB_to_coefficient (inv_log_meter (-v))) ;
+			v = - meter_coefficient (-v) ;
 		if (!rect) v += gain ;
 		ticks->value [i] = v / gain ;
 		} ;
@@ -481,9 +811,9 @@ calculate_log_ticks (bool rect, double distance, float gain, TICKS * ticks)
 		d *= gain ;
 
 		if (d > 0)
-			d = alt_log_meter (coefficient_to_dB (d)) ;
+			d = meter_deflection (d) ;
 		else
-			d = -alt_log_meter (coefficient_to_dB (-d)) ;
+			d = -meter_deflection (-d) ;
 
 		ticks->distance [i] = d*dx+dd ;
 		} ;
@@ -547,7 +877,7 @@ render_title (cairo_surface_t * surface, const RENDER * render, double left, dou
 	cairo_set_line_width (cr, BORDER_LINE_WIDTH) ;
 
 	/* Print title. */
-	cairo_select_font_face (cr, font_family, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL) ;
+	cairo_set_font_face (cr, render->font) ;
 	cairo_set_font_size (cr, 1.0 * TITLE_FONT_SIZE) ;
 
 
@@ -582,7 +912,8 @@ static void
 render_timeaxis (cairo_surface_t * surface, const RENDER * render, const SF_INFO *info, double left, double width, double top, double height)
 {
 	char text [32] ;
-	double seconds = info->frames / (1.0 * info->samplerate) ;
+	double start = render->first / (1.0 * info->samplerate) ;
+	double seconds = render->frames / (1.0 * info->samplerate) ;
 	cairo_t * cr ;
 	cairo_text_extents_t extents ;
 
@@ -595,11 +926,11 @@ render_timeaxis (cairo_surface_t * surface, const RENDER * render, const SF_INFO
 	cairo_set_line_width (cr, BORDER_LINE_WIDTH) ;
 
 	/* Print labels. */
-	cairo_select_font_face (cr, font_family, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL) ;
+	cairo_set_font_face (cr, render->font) ;
 	cairo_set_font_size (cr, 1.0 * NORMAL_FONT_SIZE) ;
 
 	/* X-Axis -- time */
-	tick_count = calculate_ticks (seconds, width, &ticks) ;
+	tick_count = calculate_time_ticks (start, seconds, width, &ticks) ;
 	for (k = 0 ; k < tick_count ; k++)
 	{	y_line (cr, left + ticks.distance [k], top + height, TICK_LEN) ;
 		if (k % 2 == 1)
@@ -626,7 +957,8 @@ render_timecode (cairo_surface_t * surface, const RENDER * render, const SF_INFO
 {
 	char text [32] ;
 	bool print_label = false ;
-	double seconds = info->frames / (1.0 * info->samplerate) ;
+	double start = render->first / (1.0 * info->samplerate) ;
+	double seconds = render->frames / (1.0 * info->samplerate) ;
 	cairo_t * cr ;
 	cairo_text_extents_t extents ;
 
@@ -639,11 +971,11 @@ render_timecode (cairo_surface_t * surface, const RENDER * render, const SF_INFO
 	cairo_set_line_width (cr, BORDER_LINE_WIDTH) ;
 
 	/* Print labels. */
-	cairo_select_font_face (cr, font_family, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL) ;
+	cairo_set_font_face (cr, render->font) ;
 	cairo_set_font_size (cr, 1.0 * NORMAL_FONT_SIZE) ;
 
 	/* X-Axis -- time */
-	tick_count = calculate_ticks (seconds, width, &ticks) ;
+	tick_count = calculate_time_ticks (start, seconds, width, &ticks) ;
 	for (k = 0 ; k < tick_count ; k++)
 	{	double yoff = 0 ;
 		y_line (cr, left + ticks.distance [k], top + height, TICK_LEN) ;
@@ -686,7 +1018,7 @@ render_wav_border (cairo_surface_t * surface, const RENDER * render, double left
 	cairo_rectangle (cr, left, top, width, height) ;
 	cairo_stroke (cr) ;
 
-	cairo_select_font_face (cr, font_family, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL) ;
+	cairo_set_font_face (cr, render->font) ;
 	cairo_set_font_size (cr, 1.0 * NORMAL_FONT_SIZE) ;
 
 	if (render->logscale)
@@ -820,8 +1152,43 @@ render_y_legend (cairo_surface_t * surface, const RENDER * render, double top, d
 #endif
 } /* render_y_legend */
 
+/* The highest level drawn, over all channels if they are drawn separately. */
+static float
+image_level (const RENDER * render, const PEAKS *peaks)
+{	float mxv = 0.0 ;
+	int ch ;
+
+	for (ch = 0 ; ch < peaks->channels ; ch++)
+	{	AGC agc = { 0.0, 0.0, 0.0 } ;
+
+		if (render->channel >= 0 && ch > 0)
+			break ;
+
+		calc_peak (peaks, render->channel >= 0 ? render->channel : ch + 1, &agc) ;
+		if (render->what & PEAK)
+			mxv = MAX (mxv, MAX (agc.max, -agc.min)) ;
+		if (render->what & RMS)
+			mxv = MAX (mxv, agc.rms) ;
+		} ;
+
+	return mxv ;
+} /* image_level */
+
+static float
+image_gain (const RENDER * render, const PEAKS *peaks)
+{	float mxv ;
+
+	if (render->gain != 0.0)
+		return render->gain ;
+
+	if (! render->autogain || (mxv = image_level (render, peaks)) == 0.0)
+		return 1.0 ;
+
+	return 1.0 / mxv ;
+} /* image_gain */
+
 static void
-render_to_surface (RENDER * render, SNDFILE *infile, SF_INFO *info, cairo_surface_t * surface)
+render_to_surface (RENDER * render, const PEAKS *peaks, SF_INFO *info, cairo_surface_t * surface)
 {
 	double width, height ;
 
@@ -830,15 +1197,22 @@ render_to_surface (RENDER * render, SNDFILE *infile, SF_INFO *info, cairo_surfac
 		height = lrint (cairo_image_surface_get_height (surface) - TOP_BORDER - BOTTOM_BORDER) ;
 		}
 	else
-	{	width = render->width ;
+	{	/* A tile's bins run on past both its edges, as far as its neighbours. */
+		width = peaks->bins ;
 		height = render->height ;
 		}
 
 	cairo_t * cr ;
 	cr = cairo_create (surface) ;
 
-	/* wave-form background */
-	cairo_rectangle (cr, 0, 0, render->width, render->height) ;
+	/*
+	**	wave-form background, round all of a tile's bins so that its outline
+	**	is only drawn where the whole image has one.
+	*/
+	if (render->border)
+		cairo_rectangle (cr, 0, 0, render->width, render->height) ;
+	else
+		cairo_rectangle (cr, -render->skip, 0, width, height) ;
 	cairo_set_line_width (cr, render->border_width) ;
 	cairo_stroke_preserve (cr) ;
 	cairo_set_source_rgba (cr, C_COLOUR (&render->c_bbg)) ;
@@ -848,27 +1222,12 @@ render_to_surface (RENDER * render, SNDFILE *infile, SF_INFO *info, cairo_surfac
 	{	const double chnsep = render->channel_separation ;
 		const double mheight = (height - (info->channels - 1) * chnsep) / (1.0 * info->channels) ;
 		int ch ;
-		float gain = 1.0 ;
-		/* calc gain of all channels */
-		if (render->autogain)
-		{	float mxv = 0.0 ;
-			for (ch = 0 ; ch < info->channels ; ch++)
-			{
-				AGC agc ;
-				calc_peak (infile, info, width, ch + 1, &agc) ;
-				if (render->what & PEAK)
-					mxv = MAX (mxv, MAX (agc.max, -agc.min)) ;
-				if (render->what & RMS)
-					mxv = MAX (mxv, agc.rms) ;
-				}
-			if (mxv != 0)
-				gain = 1.0 / mxv ;
-			}
+		float gain = image_gain (render, peaks) ;
 
 		for (ch = 0 ; ch < info->channels ; ch++)
 		{
-			render_waveform (surface, render, infile, info,
-					(render->border ? LEFT_BORDER : 0),
+			render_waveform (surface, render, peaks,
+					(render->border ? LEFT_BORDER : -render->skip),
 					(render->border ? TOP_BORDER : 0) + ((mheight + chnsep) * (1.0 * ch)),
 					width, mheight, ch + 1, gain) ;
 
@@ -877,32 +1236,25 @@ render_to_surface (RENDER * render, SNDFILE *infile, SF_INFO *info, cairo_surfac
 						LEFT_BORDER, width,
 						TOP_BORDER + (mheight + chnsep) * (1.0 * ch), mheight, gain) ;
 			else if (ch > 0 && chnsep > 0)
-			{	cairo_rectangle (cr, 0, ((mheight + chnsep) * (1.0 * ch)) - chnsep, render->width, chnsep) ;
+			{	cairo_rectangle (cr, -render->skip, ((mheight + chnsep) * (1.0 * ch)) - chnsep, width, chnsep) ;
 				cairo_stroke_preserve (cr) ;
 				cairo_set_source_rgba (cr, C_COLOUR (&render->c_bg)) ;
 				cairo_fill (cr) ;
 				} ;
 		}
 	} else
-	{	float gain = 1.0 ;
-		if (render->autogain)
-		{	AGC agc ;
-			calc_peak (infile, info, width, render->channel, &agc) ;
-			float mxv = 0.0 ;
-				if (render->what & PEAK)
-					mxv = MAX (mxv, MAX (agc.max, -agc.min)) ;
-				if (render->what & RMS)
-					mxv = MAX (mxv, agc.rms) ;
-			if (mxv != 0)
-				gain = 1.0 / mxv ;
-			} ;
-		render_waveform (surface, render, infile, info,
-			(render->border ? LEFT_BORDER : 0.0), (render->border ? TOP_BORDER : 0.0),
+	{	float gain = image_gain (render, peaks) ;
+		render_waveform (surface, render, peaks,
+			(render->border ? LEFT_BORDER : -render->skip), (render->border ? TOP_BORDER : 0.0),
 			width, height, render->channel, gain) ;
 		if (render->border)
 			render_wav_border (surface, render, LEFT_BORDER, width, TOP_BORDER, height, gain) ;
 		} ;
 
+	if (render->lufs != NULL)
+		render_loudness (surface, render, peaks, (render->border ? LEFT_BORDER : -render->skip),
+				(render->border ? TOP_BORDER : 0.0), width, height) ;
+
 	if (render->border)
 	{	render_title (surface, render, LEFT_BORDER, TOP_BORDER, info->channels) ;
 		render_y_legend (surface, render, TOP_BORDER, height) ;
@@ -916,71 +1268,718 @@ render_to_surface (RENDER * render, SNDFILE *infile, SF_INFO *info, cairo_surfac
 	return ;
 } /* render_to_surface */
 
-static void
-render_cairo_surface (RENDER * render, SNDFILE *infile, SF_INFO *info)
+/*
+**	A blank surface for the image, the batch worker's scratch surface
+**	cleared if it is the right size.
+*/
+static cairo_surface_t *
+image_surface (const RENDER * render)
 {
 	cairo_surface_t * surface = NULL ;
-	cairo_status_t status ;
+
+	if (render->scratch != NULL && *render->scratch != NULL
+			&& cairo_image_surface_get_width (*render->scratch) == render->width
+			&& cairo_image_surface_get_height (*render->scratch) == render->height)
+	{	surface = *render->scratch ;
+		cairo_surface_flush (surface) ;
+		memset (cairo_image_surface_get_data (surface), 0, (size_t) cairo_image_surface_get_stride (surface) * render->height) ;
+		cairo_surface_mark_dirty (surface) ;
+		return surface ;
+		} ;
 
 	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, render->width, render->height) ;
 	if (surface == NULL || cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
-	{	status = cairo_surface_status (surface) ;
-		printf ("Error while creating surface: %s\n", cairo_status_to_string (status)) ;
-		return ;
+		return surface ;
+
+	if (render->scratch != NULL)
+	{	if (*render->scratch != NULL)
+			cairo_surface_destroy (*render->scratch) ;
+		*render->scratch = surface ;
+		} ;
+
+	return surface ;
+} /* image_surface */
+
+/*
+**	Write the --playhead frames of the image drawn to surface, numbered from
+**	<png-file>. Each is a copy of the image with the part already played
+**	tinted and a line at the playhead, so the waveform is only drawn once.
+*/
+static cairo_status_t
+write_frames (const RENDER * render, const SF_INFO *info, cairo_surface_t * surface)
+{	cairo_surface_t *frame ;
+	cairo_status_t status ;
+	double left = 0.0, top = 0.0, width = render->width, height = render->height ;
+	char path [1024] ;
+	size_t size ;
+	int k, frames ;
+
+	if (render->border)
+	{	left = LEFT_BORDER ;
+		top = TOP_BORDER ;
+		width = lrint (render->width - LEFT_BORDER - RIGHT_BORDER) ;
+		height = lrint (render->height - TOP_BORDER - BOTTOM_BORDER) ;
+		} ;
+
+	frames = (int) ceil (render->frames * render->fps / info->samplerate) ;
+
+	frame = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, render->width, render->height) ;
+	if ((status = cairo_surface_status (frame)) != CAIRO_STATUS_SUCCESS)
+	{	cairo_surface_destroy (frame) ;
+		return status ;
 		} ;
 
 	cairo_surface_flush (surface) ;
+	size = (size_t) cairo_image_surface_get_stride (surface) * render->height ;
 
-	render_to_surface (render, infile, info, surface) ;
+	for (k = 0 ; status == CAIRO_STATUS_SUCCESS && k < frames ; k++)
+	{	double x = left + width * MIN ((double) k * info->samplerate / render->fps / render->frames, 1.0) ;
+		cairo_t *cr ;
 
-	status = cairo_surface_write_to_png (surface, render->pngfilepath) ;
-	if (status != CAIRO_STATUS_SUCCESS)
-		printf ("Error while creating PNG file: %s\n", cairo_status_to_string (status)) ;
+		cairo_surface_flush (frame) ;
+		memcpy (cairo_image_surface_get_data (frame), cairo_image_surface_get_data (surface), size) ;
+		cairo_surface_mark_dirty (frame) ;
 
-	cairo_surface_destroy (surface) ;
+		cr = cairo_create (frame) ;
 
-	return ;
-} /* render_cairo_surface */
+		cairo_rectangle (cr, left, top, x - left, height) ;
+		cairo_set_source_rgba (cr, C_COLOUR (&render->c_played)) ;
+		cairo_fill (cr) ;
 
-static void
-render_sndfile (RENDER * render)
-{
-	SNDFILE *infile ;
-	SF_INFO info = { } ;
-	sf_count_t max_width ;
+		/* On a whole pixel, and the last one of the plot at the very end. */
+		x = MIN (floor (x), left + width - 1.0) + 0.5 ;
+		cairo_set_line_width (cr, 1.0) ;
+		cairo_move_to (cr, x, top) ;
+		cairo_line_to (cr, x, top + height) ;
+		cairo_set_source_rgba (cr, C_COLOUR (&render->c_head)) ;
+		cairo_stroke (cr) ;
 
-	infile = sf_open (render->sndfilepath, SFM_READ, &info) ;
-	if (infile == NULL)
-	{	printf ("Error: failed to open file '%s': \n%s\n", render->sndfilepath, sf_strerror (NULL)) ;
-		exit (EXIT_FAILURE) ;
-		} ;
+		cairo_destroy (cr) ;
 
-	if (render->channel > info.channels)
-	{	printf ("Error: channel parameter must be in range [%d, %d]\n", -1, info.channels) ;
-		sf_close (infile) ;
-		exit (EXIT_FAILURE) ;
+		numbered_path (path, sizeof (path), render->pngfilepath, k) ;
+		status = image_write (frame, path, &render->image) ;
 		} ;
 
-	max_width = info.frames ;
-	if (render->border)
-		max_width += LEFT_BORDER + RIGHT_BORDER ;
+	cairo_surface_destroy (frame) ;
 
-	if (render->width > max_width)
-	{	printf ("Error: soundfile is too short. Decrease image width below %ld.\n", (long int) max_width) ;
-		sf_close (infile) ;
-		exit (EXIT_FAILURE) ;
-		} ;
+	return status ;
+} /* write_frames */
 
-	if (render->geometry_no_border)	// given geometry applies to wave-form (per channel) without border.
-	{	if (render->channel < 0)
-			render->height = render->height * info.channels + (info.channels-1) * render->channel_separation ;
+static bool
+render_cairo_surface (RENDER * render, const PEAKS *peaks, SF_INFO *info)
+{
+	cairo_surface_t * surface = NULL ;
+	cairo_status_t status ;
 
-		if (render->border)
-		{	render->width += LEFT_BORDER + RIGHT_BORDER ;
-			render->height += TOP_BORDER + BOTTOM_BORDER ;
-			} ;
+	surface = image_surface (render) ;
+	if (surface == NULL || cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+	{	status = cairo_surface_status (surface) ;
+		printf ("Error while creating surface: %s\n", cairo_status_to_string (status)) ;
+		if (surface != NULL)
+			cairo_surface_destroy (surface) ;
+		return false ;
 		} ;
 
+	cairo_surface_flush (surface) ;
+
+	render_to_surface (render, peaks, info, surface) ;
+
+	if (render->fps > 0.0)
+		status = write_frames (render, info, surface) ;
+	else
+		status = image_write (surface, render->pngfilepath, &render->image) ;
+	if (status != CAIRO_STATUS_SUCCESS)
+		printf ("Error while creating image file: %s\n", cairo_status_to_string (status)) ;
+
+	if (render->scratch == NULL)
+		cairo_surface_destroy (surface) ;
+
+	return status == CAIRO_STATUS_SUCCESS ;
+} /* render_cairo_surface */
+
+/* The width of the waveform, without the border, in an image. */
+static int
+plot_width (const RENDER * render)
+{
+	return render->border ? lrint (render->width - LEFT_BORDER - RIGHT_BORDER) : render->width ;
+} /* plot_width */
+
+static void
+image_geometry (RENDER * render, const SF_INFO *info)
+{
+	if (render->geometry_no_border)	// given geometry applies to wave-form (per channel) without border.
+	{	if (render->channel < 0)
+			render->height = render->height * info->channels + (info->channels-1) * render->channel_separation ;
+
+		if (render->border)
+		{	render->width += LEFT_BORDER + RIGHT_BORDER ;
+			render->height += TOP_BORDER + BOTTOM_BORDER ;
+			} ;
+		} ;
+} /* image_geometry */
+
+static bool
+check_image_width (const RENDER * render)
+{	sf_count_t max_width ;
+
+	max_width = render->frames ;
+	if (render->border)
+		max_width += LEFT_BORDER + RIGHT_BORDER ;
+
+	if (render->width > max_width)
+	{	printf ("Error: soundfile or time window is too short. Decrease image width below %ld.\n", (long int) max_width) ;
+		return false ;
+		} ;
+
+	return true ;
+} /* check_image_width */
+
+/* Every image to draw, the -g targets and then <png-file>. */
+static int
+image_list (const RENDER * render, const SF_INFO *info, RENDER * image)
+{	int k, images = 0 ;
+
+	for (k = 0 ; k < render->targets ; k++)
+	{	image [images] = *render ;
+		image [images].width = render->target [k].width ;
+		image [images].height = render->target [k].height ;
+		image [images].pngfilepath = render->target [k].path ;
+		images ++ ;
+		} ;
+
+	if (render->pngfilepath != NULL)
+		image [images++] = *render ;
+
+	for (k = 0 ; k < images ; k++)
+		image_geometry (&image [k], info) ;
+
+	return images ;
+} /* image_list */
+
+static int64_t
+gcd64 (int64_t a, int64_t b)
+{	while (b != 0)
+	{	int64_t t = a % b ;
+		a = b ;
+		b = t ;
+		} ;
+	return a ;
+} /* gcd64 */
+
+/* Draw each image from peaks, merging them to its width. */
+static bool
+draw_images (RENDER * image, int images, PEAKS *peaks, SF_INFO *info)
+{	bool ok = true ;
+	int k ;
+
+	for (k = 0 ; k < images ; k++)
+	{	PEAKS *merged = peaks ;
+
+		if (plot_width (&image [k]) != peaks->bins || image [k].frames != peaks->frames)
+			merged = peaks_merge (peaks, plot_width (&image [k]), image [k].frames) ;
+
+		ok = render_cairo_surface (&image [k], merged, info) && ok ;
+
+		if (merged != peaks)
+			peaks_destroy (merged) ;
+		} ;
+
+	return ok ;
+} /* draw_images */
+
+/*
+**	Read the file once for all the images. The bins are the least common
+**	multiple of the image widths so each image merges them exactly, or the
+**	widest image's if that would be too many, when the others are merged
+**	to the nearest bin.
+*/
+static bool
+render_images (const RENDER * render, SNDFILE *infile, SF_INFO *info)
+{	RENDER image [MAX_TARGETS + 1] ;
+	LOUDNESS *loudness ;
+	PEAKS *peaks ;
+	int64_t bins = 1 ;
+	int k, images, widest = 0 ;
+	bool ok ;
+
+	images = image_list (render, info, image) ;
+
+	for (k = 0 ; k < images ; k++)
+	{	int width = plot_width (&image [k]) ;
+
+		if (! check_image_width (&image [k]))
+			return false ;
+		widest = MAX (widest, width) ;
+		if (bins <= MAX_SHARED_BINS)
+			bins = bins / gcd64 (bins, width) * width ;
+		} ;
+
+	if (bins > MAX_SHARED_BINS || bins > render->frames)
+		bins = widest ;
+
+	/* The loudness is measured along the way, unless the export has done it. */
+	loudness = render->exportpath == NULL ? render->lufs : NULL ;
+
+	peaks = NULL ;
+	if (render->overviewpath != NULL && render->frames == info->frames && render->rms_window == 0.0 && loudness == NULL)
+		peaks = overview_peaks (render, infile, info, (int) bins) ;
+	if (peaks == NULL)
+		peaks = scan_peaks (render, infile, info, (int) bins, render->frames, loudness) ;
+
+	ok = draw_images (image, images, peaks, info) ;
+
+	peaks_destroy (peaks) ;
+	return ok ;
+} /* render_images */
+
+static void
+write_export (const RENDER * render, const PEAKS *peaks, const SF_INFO *info, int samples_per_pixel)
+{
+	if (! export_peaks (render->exportpath, peaks, render->channel, info->samplerate,
+				samples_per_pixel, render->export_bits, render->what & RMS))
+	{	printf ("Error: could not write '%s'.\n", render->exportpath) ;
+		exit (EXIT_FAILURE) ;
+		} ;
+} /* write_export */
+
+/*
+**	Bin the window in runs of samples_per_pixel frames, the last of them
+**	maybe shorter, and write the bins to the export file.
+*/
+static void
+export_sndfile (const RENDER * render, SNDFILE *infile, const SF_INFO *info)
+{	PEAKS *peaks ;
+	sf_count_t samples_per_pixel, bins ;
+
+	samples_per_pixel = render->samples_per_pixel ;
+	if (samples_per_pixel <= 0)
+		samples_per_pixel = (render->frames + render->width - 1) / render->width ;
+
+	bins = (render->frames + samples_per_pixel - 1) / samples_per_pixel ;
+	if (samples_per_pixel > INT_MAX || bins > INT_MAX)
+	{	printf ("Error: too many or too few samples per pixel to export.\n") ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	peaks = scan_peaks (render, infile, info, (int) bins, bins * samples_per_pixel, render->lufs) ;
+	write_export (render, peaks, info, (int) samples_per_pixel) ;
+	peaks_destroy (peaks) ;
+} /* export_sndfile */
+
+typedef struct
+{	PEAKS *peaks ;
+	RMS_WINDOW *rms ;
+	bool fixed ;	/* Add bins of the same size, rather than doubling their size. */
+} STREAM ;
+
+static void
+stream_open (STREAM * stream, const RENDER * render, const SF_INFO *info, int bins, int samples_per_pixel, bool fixed)
+{
+	stream->peaks = peaks_create (bins, info->channels, (sf_count_t) bins * samples_per_pixel) ;
+	stream->rms = NULL ;
+	stream->fixed = fixed ;
+
+	if (render->rms_window > 0.0)
+	{	stream->peaks->rms_window = MAX (1, lrint (render->rms_window * info->samplerate / 1000.0)) ;
+		stream->rms = rms_window_create (info->channels, stream->peaks->rms_window) ;
+		} ;
+} /* stream_open */
+
+/* Make room in the bins for the frames up to end. */
+static void
+stream_grow (STREAM * stream, sf_count_t end)
+{
+	while (end > stream->peaks->frames)
+	{	PEAKS *peaks = stream->peaks, *half ;
+
+		if (stream->fixed)
+			stream->peaks = peaks_resize (peaks, 2 * peaks->bins) ;
+		else
+		{	/* Pairs of bins into the first half, leaving the second half free. */
+			half = peaks_merge (peaks, peaks->bins / 2, peaks->frames) ;
+			stream->peaks = peaks_resize (half, peaks->bins) ;
+			peaks_destroy (half) ;
+			} ;
+
+		peaks_destroy (peaks) ;
+		} ;
+} /* stream_grow */
+
+/*
+**	Bin the window of a file that cannot seek, and may not know its length,
+**	in one pass from wherever it is. Returns the frames read.
+*/
+static sf_count_t
+stream_peaks (const RENDER *render, SNDFILE *infile, STREAM * stream, int streams)
+{	float *data ;
+	sf_count_t pos, count ;
+	int k ;
+
+	data = malloc (sizeof (float) * SCAN_FRAMES * stream [0].peaks->channels) ;
+	if (!data)
+	{	printf ("out of memory.\n") ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	/* The frames before the window only go through the RMS windows and the loudness filters. */
+	pos = -render->first ;
+	while (pos < 0 && (count = sf_readf_float (infile, data, MIN (SCAN_FRAMES, -pos))) > 0)
+	{	for (k = 0 ; k < streams ; k++)
+			if (stream [k].rms != NULL)
+				rms_window_add (stream [k].rms, data, count) ;
+		if (render->lufs != NULL)
+			loudness_add (render->lufs, render->first + pos, data, count) ;
+		pos += count ;
+		} ;
+
+	while (pos >= 0 && pos < render->frames
+			&& (count = sf_readf_float (infile, data, MIN (SCAN_FRAMES, render->frames - pos))) > 0)
+	{	for (k = 0 ; k < streams ; k++)
+		{	stream_grow (&stream [k], pos + count) ;
+			peaks_add_float (stream [k].peaks, pos, data, count) ;
+			if (stream [k].rms != NULL)
+				peaks_add_rms (stream [k].peaks, stream [k].rms, pos, data, count) ;
+			} ;
+		if (render->lufs != NULL)
+			loudness_add (render->lufs, render->first + pos, data, count) ;
+		pos += count ;
+		} ;
+
+	for (k = 0 ; k < streams ; k++)
+		if (stream [k].rms != NULL)
+			rms_window_destroy (stream [k].rms) ;
+
+	free (data) ;
+	return MAX (pos, 0) ;
+} /* stream_peaks */
+
+/*
+**	Export and draw a file that cannot seek, such as a pipe, in one pass.
+**	The export bins are a fixed samples_per_pixel and grow in number as the
+**	audio comes in. The image bins double in size whenever they fill up, so
+**	there are always between STREAM_BINS and twice that many per pixel, and
+**	each image is merged from them once the length is known.
+*/
+static bool
+stream_sndfile (RENDER * render, SNDFILE *infile, SF_INFO *info)
+{	RENDER image [MAX_TARGETS + 1] ;
+	STREAM stream [2] ;
+	int k, images, streams = 0, widest = 0 ;
+	bool ok ;
+
+	images = image_list (render, info, image) ;
+	for (k = 0 ; k < images ; k++)
+		widest = MAX (widest, plot_width (&image [k])) ;
+
+	if (render->exportpath != NULL)
+	{	if (render->samples_per_pixel <= 0)
+		{	printf ("Error: --export of a file that cannot seek needs --samples-per-pixel.\n") ;
+			return false ;
+			} ;
+		stream_open (&stream [streams++], render, info, 1024, render->samples_per_pixel, true) ;
+		} ;
+
+	/* Just measuring the loudness still reads into some bins. */
+	if (images > 0 || streams == 0)
+		stream_open (&stream [streams++], render, info, 2 * STREAM_BINS * MAX (widest, 1), 1, false) ;
+
+	render->frames = stream_peaks (render, infile, stream, streams) ;
+	ok = render->frames > 0 ;
+	if (! ok)
+		printf ("Error: the time window is outside the sound file.\n") ;
+
+	if (ok && render->exportpath != NULL)
+	{	int samples_per_pixel = render->samples_per_pixel ;
+		PEAKS *peaks ;
+
+		peaks = peaks_resize (stream [0].peaks, (int) ((render->frames + samples_per_pixel - 1) / samples_per_pixel)) ;
+		write_export (render, peaks, info, samples_per_pixel) ;
+		peaks_destroy (peaks) ;
+		} ;
+
+	for (k = 0 ; ok && k < images ; k++)
+	{	image [k].frames = render->frames ;
+		ok = check_image_width (&image [k]) ;
+		} ;
+
+	if (ok && images > 0)
+		ok = draw_images (image, images, stream [streams - 1].peaks, info) ;
+
+	for (k = 0 ; k < streams ; k++)
+		peaks_destroy (stream [k].peaks) ;
+
+	return ok ;
+} /* stream_sndfile */
+
+/* One channel of one pixel of a tiled image, smaller than a PEAK_BIN. */
+typedef struct
+{	float min, max, rms ;
+} PIXEL ;
+
+/* First frame of the window in pixel k of width. */
+static sf_count_t
+pixel_edge (const RENDER * render, int width, int k)
+{
+	return ((sf_count_t) k * render->frames) / width ;
+} /* pixel_edge */
+
+/* The part of render that tile t, of the tiles of width, draws. */
+static void
+tile_render (const RENDER * render, int width, int t, RENDER * tile, char * path, size_t pathlen)
+{	int x = t * render->tile_width ;
+
+	*tile = *render ;
+	tile->width = MIN (render->tile_width, width - x) ;
+	tile->first = render->first + pixel_edge (render, width, x) ;
+	tile->frames = pixel_edge (render, width, x + tile->width) - pixel_edge (render, width, x) ;
+
+	numbered_path (path, pathlen, render->pngfilepath, t) ;
+	tile->pngfilepath = path ;
+} /* tile_render */
+
+static void
+write_manifest (const RENDER * render, const SF_INFO *info, int width, int tiles)
+{	const char *ext, *name, *slash ;
+	char path [1024], tilepath [1024] ;
+	FILE *file ;
+	int t ;
+
+	ext = strrchr (render->pngfilepath, '.') ;
+	slash = strrchr (render->pngfilepath, '/') ;
+	if (ext == NULL || (slash != NULL && ext < slash))
+		ext = render->pngfilepath + strlen (render->pngfilepath) ;
+	snprintf (path, sizeof (path), "%.*s.json", (int) (ext - render->pngfilepath), render->pngfilepath) ;
+
+	if ((file = fopen (path, "w")) == NULL)
+	{	printf ("Error: could not write '%s'.\n", path) ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	fprintf (file, "{\"sample_rate\":%d,\"channels\":%d,\"width\":%d,\"height\":%d,\"tile_width\":%d,\"tiles\":[",
+			info->samplerate, info->channels, width, render->height, render->tile_width) ;
+
+	for (t = 0 ; t < tiles ; t++)
+	{	RENDER tile ;
+
+		tile_render (render, width, t, &tile, tilepath, sizeof (tilepath)) ;
+		name = strrchr (tilepath, '/') ;
+		name = name != NULL ? name + 1 : tilepath ;
+
+		fprintf (file, "%s\n{\"file\":\"", t > 0 ? "," : "") ;
+		for ( ; *name ; name++)
+			fprintf (file, *name == '"' || *name == '\\' ? "\\%c" : "%c", *name) ;
+		fprintf (file, "\",\"x\":%d,\"width\":%d,\"first_frame\":%lld,\"frames\":%lld,\"start\":%.6f,\"end\":%.6f}",
+				t * render->tile_width, tile.width, (long long) tile.first, (long long) tile.frames,
+				(double) tile.first / info->samplerate, (double) (tile.first + tile.frames) / info->samplerate) ;
+		} ;
+
+	fprintf (file, "]}\n") ;
+
+	if (fclose (file) != 0)
+	{	printf ("Error: could not write '%s'.\n", path) ;
+		exit (EXIT_FAILURE) ;
+		} ;
+} /* write_manifest */
+
+/*
+**	Draw the image as tiles of tile_width pixels, for images too wide for
+**	one surface. Each tile is binned in turn and kept as PIXELs of just the
+**	channels drawn, so the gain can be worked out over the whole image,
+**	and then each tile is drawn from those and written. Only one tile's
+**	bins and surface are ever held at once.
+*/
+static bool
+render_tiles (RENDER * render, SNDFILE *infile, SF_INFO *info)
+{	PIXEL *pixel ;
+	char path [1024] ;
+	sf_count_t width ;
+	float level = 0.0 ;
+	int t, tiles, channels = render->channel < 0 ? info->channels : 1 ;
+	bool ok = true ;
+
+	width = render->width ;
+	if (render->samples_per_pixel > 0)
+		width = (render->frames + render->samples_per_pixel - 1) / render->samples_per_pixel ;
+
+	if (width > INT_MAX || (pixel = malloc (width * channels * sizeof (PIXEL))) == NULL)
+	{	printf ("Error: the image is too wide.\n") ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	render->width = (int) width ;
+	if (! check_image_width (render))
+	{	free (pixel) ;
+		return false ;
+		} ;
+
+	image_geometry (render, info) ;
+	tiles = (render->width + render->tile_width - 1) / render->tile_width ;
+
+	for (t = 0 ; t < tiles ; t++)
+	{	RENDER tile ;
+		PEAKS *peaks ;
+		int x, c ;
+
+		tile_render (render, (int) width, t, &tile, path, sizeof (path)) ;
+		peaks = scan_peaks (&tile, infile, info, tile.width, tile.frames, render->exportpath == NULL ? render->lufs : NULL) ;
+		level = MAX (level, image_level (render, peaks)) ;
+
+		for (x = 0 ; x < tile.width ; x++)
+			for (c = 0 ; c < channels ; c++)
+			{	PIXEL *dest = pixel + ((sf_count_t) t * render->tile_width + x) * channels + c ;
+				PEAK_BIN bin ;
+
+				peaks_get (peaks, render->channel < 0 ? c : render->channel - 1, x, &bin) ;
+				dest->min = bin.min ;
+				dest->max = bin.max ;
+				dest->rms = peaks_rms (peaks, &bin) ;
+				} ;
+
+		peaks_destroy (peaks) ;
+		} ;
+
+	if (render->autogain && level != 0.0)
+		render->gain = 1.0 / level ;
+
+	/* The tiles only hold the channels drawn, merged to one if need be. */
+	if (render->channel > 0)
+		render->channel = 0 ;
+
+	for (t = 0 ; t < tiles ; t++)
+	{	RENDER tile ;
+		PEAKS *peaks ;
+		sf_count_t left ;
+		int x, c, bins ;
+
+		/* With the pixels either side whose lines reach into this tile. */
+		tile_render (render, (int) width, t, &tile, path, sizeof (path)) ;
+		left = (sf_count_t) t * render->tile_width ;
+		tile.skip = (int) MIN (left, TILE_OVERLAP) ;
+		bins = tile.skip + tile.width + (int) MIN (width - left - tile.width, TILE_OVERLAP) ;
+		left -= tile.skip ;
+
+		peaks = peaks_create (bins, channels, pixel_edge (render, (int) width, left + bins) - pixel_edge (render, (int) width, left)) ;
+		if (render->rms_window > 0.0)
+			peaks->rms_window = MAX (1, lrint (render->rms_window * info->samplerate / 1000.0)) ;
+
+		for (x = 0 ; x < bins ; x++)
+			for (c = 0 ; c < channels ; c++)
+			{	const PIXEL *src = pixel + (left + x) * channels + c ;
+				PEAK_BIN *bin = peaks->bin + c * peaks->bins + x ;
+
+				bin->min = src->min ;
+				bin->max = src->max ;
+				bin->count = peaks_edge (peaks, x + 1) - peaks_edge (peaks, x) ;
+				bin->sumsq = (double) src->rms * src->rms * bin->count ;
+				bin->rms_max = src->rms ;
+				} ;
+
+		ok = render_cairo_surface (&tile, peaks, info) && ok ;
+		peaks_destroy (peaks) ;
+		} ;
+
+	write_manifest (render, info, (int) width, tiles) ;
+	free (pixel) ;
+
+	return ok ;
+} /* render_tiles */
+
+/* A figure of the loudness JSON, null if there is none. */
+static void
+json_loudness (FILE * file, const char * name, double value, const char * sep)
+{
+	if (isfinite (value))
+		fprintf (file, "\"%s\":%.2f%s", name, value, sep) ;
+	else
+		fprintf (file, "\"%s\":null%s", name, sep) ;
+} /* json_loudness */
+
+static void
+write_loudness (const RENDER * render)
+{	LOUDNESS_RESULT result ;
+	FILE *file ;
+
+	loudness_result (render->lufs, &result) ;
+
+	if (render->loudnesspath == NULL)
+	{	printf ("Integrated loudness : %.1f LUFS\n", result.integrated) ;
+		printf ("Loudness range      : %.1f LU\n", result.range) ;
+		printf ("Momentary maximum   : %.1f LUFS\n", result.momentary_max) ;
+		printf ("Short-term maximum  : %.1f LUFS\n", result.short_term_max) ;
+		printf ("True peak           : %.1f dBTP\n", result.true_peak) ;
+		return ;
+		} ;
+
+	if ((file = fopen (render->loudnesspath, "w")) == NULL)
+	{	printf ("Error: could not write '%s'.\n", render->loudnesspath) ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	fprintf (file, "{") ;
+	json_loudness (file, "integrated", result.integrated, ",") ;
+	json_loudness (file, "range", result.range, ",") ;
+	json_loudness (file, "momentary_max", result.momentary_max, ",") ;
+	json_loudness (file, "short_term_max", result.short_term_max, ",") ;
+	json_loudness (file, "true_peak", result.true_peak, "") ;
+	fprintf (file, "}\n") ;
+
+	if (fclose (file) != 0)
+	{	printf ("Error: could not write '%s'.\n", render->loudnesspath) ;
+		exit (EXIT_FAILURE) ;
+		} ;
+} /* write_loudness */
+
+/*
+**	Draw one sound file, returning false if it could not be read or an image
+**	could not be written, so that a batch can go on to the next file.
+*/
+static bool
+render_sndfile (RENDER * render)
+{
+	SNDFILE *infile ;
+	SF_INFO info = { } ;
+	char overviewpath [1024] ;
+	const char *name ;
+	bool ok = true ;
+
+	infile = sf_open (render->sndfilepath, SFM_READ, &info) ;
+	if (infile == NULL)
+	{	printf ("Error: failed to open file '%s': \n%s\n", render->sndfilepath, sf_strerror (NULL)) ;
+		return false ;
+		} ;
+
+	if (render->channel > info.channels)
+	{	printf ("Error: channel parameter must be in range [%d, %d]\n", -1, info.channels) ;
+		sf_close (infile) ;
+		return false ;
+		} ;
+
+	name = strrchr (render->sndfilepath, '/') ;
+	render->filename = name != NULL ? name + 1 : render->sndfilepath ;
+
+	if (render->overviewpath != NULL && render->overviewpath [0] == 0)
+	{	snprintf (overviewpath, sizeof (overviewpath), "%s.sfov", render->sndfilepath) ;
+		render->overviewpath = overviewpath ;
+		} ;
+
+	/* The length a pipe gives, if any, is only known once it has been read. */
+	if (! info.seekable)
+		info.frames = SF_COUNT_MAX ;
+
+	if (! info.seekable && render->tile_width > 0)
+	{	printf ("Error: --tile-width needs a sound file that can seek.\n") ;
+		sf_close (infile) ;
+		return false ;
+		} ;
+
+	render->first = llrint (render->start * info.samplerate) ;
+	render->frames = render->end < 0 ? info.frames : MIN (info.frames, llrint (render->end * info.samplerate)) ;
+	render->frames -= render->first ;
+	if (render->frames <= 0)
+	{	printf ("Error: the time window is outside the sound file.\n") ;
+		sf_close (infile) ;
+		return false ;
+		} ;
 
 	if (render->tc_den > 0 && render->parse_bwf)	/* use BWF timecode offset */
 	{	SF_BROADCAST_INFO_2K binfo = { } ;
@@ -994,13 +1993,195 @@ render_sndfile (RENDER * render)
 		} ;
 	render->tc_off /= 1.0 * info.samplerate ;
 
-	render_cairo_surface (render, infile, &info) ;
+	if (render->loudness)
+		render->lufs = loudness_create (info.channels, info.samplerate, render->first) ;
+
+	if (! info.seekable)
+		ok = stream_sndfile (render, infile, &info) ;
+	else
+	{	if (render->exportpath != NULL)
+			export_sndfile (render, infile, &info) ;
+
+		if (render->tile_width > 0)
+			ok = render_tiles (render, infile, &info) ;
+		else if (render->pngfilepath != NULL || render->targets > 0)
+			ok = render_images (render, infile, &info) ;
+		else if (render->exportpath == NULL && render->lufs != NULL)
+			peaks_destroy (scan_peaks (render, infile, &info, (int) MIN (MAX (render->image.threads, 1), render->frames),
+								render->frames, render->lufs)) ;
+		} ;
+
+	if (render->lufs != NULL)
+	{	if (ok)
+			write_loudness (render) ;
+		loudness_destroy (render->lufs) ;
+		render->lufs = NULL ;
+		} ;
 
 	sf_close (infile) ;
 
-	return ;
+	return ok ;
 } /* render_sndfile */
 
+/* The jobs of a --batch manifest, taken in turn by each worker. */
+typedef struct
+{	const RENDER *render ;
+	char **path ;	/* The sound file and then the image of each job. */
+	int jobs, next, failed ;
+	pthread_mutex_t lock ;
+} BATCH ;
+
+/*
+**	Read a --batch manifest, a <sound-file> and a <png-file> on each line.
+**	They are split at a tab, so that either path may hold spaces, or at
+**	white space if there is no tab. Blank lines and those starting with #
+**	are skipped.
+*/
+static void
+read_batch (const char * batchpath, BATCH * batch)
+{	char line [2048], *sndfilepath, *pngfilepath, *end ;
+	FILE *file ;
+	int lineno = 0 ;
+
+	file = strcmp (batchpath, "-") == 0 ? stdin : fopen (batchpath, "r") ;
+	if (file == NULL)
+	{	printf ("Error: could not read '%s'.\n", batchpath) ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	while (fgets (line, sizeof (line), file) != NULL)
+	{	lineno ++ ;
+
+		if (strchr (line, '\n') == NULL && ! feof (file))
+		{	printf ("Error: line %d of '%s' is too long.\n", lineno, batchpath) ;
+			exit (EXIT_FAILURE) ;
+			} ;
+
+		sndfilepath = line + strspn (line, " \t") ;
+		if (*sndfilepath == '#' || sndfilepath [strspn (sndfilepath, " \t\r\n")] == 0)
+			continue ;
+
+		end = sndfilepath + strcspn (sndfilepath, "\r\n") ;
+		while (end > sndfilepath && (end [-1] == ' ' || end [-1] == '\t'))
+			end -- ;
+		*end = 0 ;
+
+		if ((pngfilepath = strchr (sndfilepath, '\t')) == NULL)
+			pngfilepath = sndfilepath + strcspn (sndfilepath, " ") ;
+		if (*pngfilepath != 0)
+			*pngfilepath++ = 0 ;
+		pngfilepath += strspn (pngfilepath, " \t") ;
+
+		if (*pngfilepath == 0 || strcmp (sndfilepath, "-") == 0 || strcmp (pngfilepath, "-") == 0)
+		{	printf ("Error: line %d of '%s' needs a <sound-file> and a <png-file>, neither of them \"-\".\n", lineno, batchpath) ;
+			exit (EXIT_FAILURE) ;
+			} ;
+
+		if (batch->jobs % 64 == 0
+				&& (batch->path = realloc (batch->path, (batch->jobs + 64) * 2 * sizeof (char *))) == NULL)
+		{	printf ("%s : Not enough memory.\n", __func__) ;
+			exit (EXIT_FAILURE) ;
+			} ;
+
+		if ((batch->path [2 * batch->jobs] = strdup (sndfilepath)) == NULL
+				|| (batch->path [2 * batch->jobs + 1] = strdup (pngfilepath)) == NULL)
+		{	printf ("%s : Not enough memory.\n", __func__) ;
+			exit (EXIT_FAILURE) ;
+			} ;
+		batch->jobs ++ ;
+		} ;
+
+	if (file != stdin)
+		fclose (file) ;
+} /* read_batch */
+
+/*
+**	Draw jobs until there are none left. Each worker keeps one surface from
+**	job to job, so that images of the same size are drawn without making a
+**	new one each time.
+*/
+static void *
+batch_worker (void * arg)
+{	BATCH *batch = arg ;
+	cairo_surface_t *scratch = NULL ;
+
+	for ( ; ; )
+	{	RENDER render = *batch->render ;
+		int job = -1 ;
+
+		pthread_mutex_lock (&batch->lock) ;
+		if (batch->next < batch->jobs)
+			job = batch->next ++ ;
+		pthread_mutex_unlock (&batch->lock) ;
+
+		if (job < 0)
+			break ;
+
+		render.sndfilepath = batch->path [2 * job] ;
+		render.pngfilepath = batch->path [2 * job + 1] ;
+		render.scratch = &scratch ;
+
+		if (! render_sndfile (&render))
+		{	printf ("Error: could not draw '%s'.\n", render.sndfilepath) ;
+			pthread_mutex_lock (&batch->lock) ;
+			batch->failed ++ ;
+			pthread_mutex_unlock (&batch->lock) ;
+			} ;
+		} ;
+
+	if (scratch != NULL)
+		cairo_surface_destroy (scratch) ;
+
+	return NULL ;
+} /* batch_worker */
+
+/*
+**	Draw every file of a --batch manifest, --threads of them at once and
+**	each on one thread, in the one process. A file that cannot be drawn
+**	is reported and the rest are still drawn.
+*/
+static bool
+render_batch (const RENDER * render, const char * batchpath)
+{	BATCH batch = { } ;
+	RENDER job = *render ;
+	pthread_t *tids ;
+	int k, workers, started = 1 ;
+
+	job.image.threads = 1 ;
+	batch.render = &job ;
+	read_batch (batchpath, &batch) ;
+
+	workers = MIN (MAX (render->image.threads, 1), MAX (batch.jobs, 1)) ;
+	if ((tids = calloc (workers, sizeof (pthread_t))) == NULL)
+	{	printf ("%s : Not enough memory.\n", __func__) ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	pthread_mutex_init (&batch.lock, NULL) ;
+
+	/*
+	**	A worker that cannot be started just leaves its jobs to the others.
+	**	The ones that did start are packed into tids [1 .. started - 1].
+	*/
+	for (k = 1 ; k < workers ; k++)
+		if (pthread_create (&tids [started], NULL, batch_worker, &batch) == 0)
+			started ++ ;
+
+	batch_worker (&batch) ;
+
+	for (k = 1 ; k < started ; k++)
+		pthread_join (tids [k], NULL) ;
+
+	pthread_mutex_destroy (&batch.lock) ;
+
+	for (k = 0 ; k < 2 * batch.jobs ; k++)
+		free (batch.path [k]) ;
+	free (batch.path) ;
+	free (tids) ;
+
+	return batch.failed == 0 ;
+} /* render_batch */
+
 static void
 check_int_range (const char * name, int value, int lower, int upper)
 {
@@ -1033,39 +2214,108 @@ usage_exit (char * argv0, int status)
 		"or plot all channels in vertically arrangement.\n"
 		"\n"
 		"Colours (ARGB) and image- or waveform geometry can be freely specified.\n"
+		"\n"
+		"A <sound-file> of \"-\" is read from stdin. Pipes are read in one pass,\n"
+		"without needing to know their length.\n"
 		"\n") ;
 
 	printf ("Usage: %s [OPTION]  <sound-file> <png-file>\n", argv0) ;
+	printf ("       %s [OPTION] -g <w>x<h>:<png-file> ... <sound-file> [<png-file>]\n", argv0) ;
+	printf ("       %s [OPTION] --export <FILE> <sound-file> [<png-file>]\n", argv0) ;
+	printf ("       %s [OPTION] --batch <FILE>\n", argv0) ;
 	printf ("\n"
 		"Options:\n"
 		"  -A, --textcolour <COL>    specify text and border colour; default 0xffffffff\n"
 		"                            all colours as hexadecimal AA RR GG BB values\n"
 		"  -b, --border              display a border with annotations\n"
 		"  -B, --background <COL>    specify background colour; default 0x8099999f\n"
+		"  --batch <FILE>            draw each <sound-file> <png-file> pair of\n"
+		"                            the lines of FILE (\"-\" for stdin), split\n"
+		"                            at a tab or white space, with the same\n"
+		"                            options, --threads of them at once\n"
+		"  --bits <8|16>             size of the values written by --export\n"
+		"                            (default: 16)\n"
 		"  -c, --channel             choose channel (s) to plot, 0: merge to mono;\n"
 		"                            < 0: render all channels vertically separated;\n"
 		"                            > 0: render only specified channel. (default: 0)\n"
 		"  -C, --centerline <COL>    set colour of zero/center line (default 0x4cffffff)\n"
+		"  --compression <0-9>       PNG deflate level, 0 stores the image data\n"
+		"                            uncompressed (default: Cairo's PNG writer)\n"
+		"  --end <SEC>               end the plot this many seconds into the file\n"
+		"                            (default: the end of the file)\n"
+		"  --export <FILE>           write the min and max of each pixel as\n"
+		"                            audiowaveform JSON if FILE ends in .json, with\n"
+		"                            the RMS unless --no-rms is given, or as binary\n"
+		"                            .dat otherwise. The image is only drawn if\n"
+		"                            <png-file> is given too.\n"
 		"  -F, --foreground <COL>    specify foreground colour; default 0xff333333\n"
+		"  --format <NAME>           output format png, ppm, pam or rgba (raw RGBA\n"
+		"                            rows); default: from the output file extension.\n"
+		"                            A file name of \"-\" writes to stdout.\n"
 		"  -g <w>x<h>, --geometry <w>x<h>\n"
 		"                            specify the size of the image to create\n"
 		"                            default: 800x192\n"
+		"  -g <w>x<h>:<png-file>     also draw an image of that size to png-file;\n"
+		"                            may be given several times and the sound\n"
+		"                            file is only read once for all the images\n"
 		"  -G, --borderbg <COL>      specify border/annotation background colour;\n"
 		"                            default 0xb3ffffff\n"
 		"  -h, --help                display this help and exit\n"
 		"  -l, --logscale            use logarithmic scale\n"
+		"  --loudness[=<FILE>]       measure the EBU R128 loudness and true peak\n"
+		"                            while reading the file, rather than any\n"
+		"                            --overview, and print them, or write them to\n"
+		"                            FILE as JSON. The short-term loudness is\n"
+		"                            drawn over the waveform from -60 LUFS at the\n"
+		"                            bottom to 0 at the top. The image is optional.\n"
+		"  --loudnesscolour <COL>    colour of the loudness line; default 0xffff8000\n"
 		"  --no-peak                 only draw RMS signal using foreground colour\n"
 		"  --no-rms                  only draw signal peaks (exclusive with --no-peak).\n"
+		"  --overview[=<FILE>]       bin the waveform from a peak overview file,\n"
+		"                            making it first if it is missing or out of\n"
+		"                            date; default: <sound-file>.sfov\n"
+		"  --playedcolour <COL>      tint of the part played in --playhead frames;\n"
+		"                            default 0x40ffffff\n"
+		"  --playhead <FPS>          write FPS frames a second of the time window,\n"
+		"                            <png-file> numbered -0000 and so on, each\n"
+		"                            the image with a playhead line, drawn from\n"
+		"                            the one scan of the file. With a <png-file>\n"
+		"                            of \"-\" the frames are written one after\n"
+		"                            the other, e.g. as raw --format rgba video\n"
+		"  --playheadcolour <COL>    colour of the playhead line; default 0xffff0000\n"
 		"  -r, --rectified           rectify waveform\n"
 		"  -R, --rmscolour  <COL>    specify RMS colour; default 0xffb3b3b3\n"
+		"  --rms-window <MS>         draw the highest RMS over a sliding window of\n"
+		"                            MS milliseconds in each pixel, rather than the\n"
+		"                            RMS of the pixel, so that it does not change\n"
+		"                            with the width\n"
 		"  -s, --gainscale           zoom into y-axis, map max signal to height.\n"
+		"  --samples-per-pixel <NUM> frames in each pixel written by --export\n"
+		"                            or drawn by --tile-width\n"
+		"                            (default: the file or window over the width;\n"
+		"                            required when reading a pipe)\n"
 		"  -S, --separator <px>      vertically separate channels by N pixels\n"
 		"                            (default: 12) - only used with -c -1\n"
+		"  --start <SEC>             start the plot this many seconds into the file;\n"
+		"                            only that window is read and the time axis\n"
+		"                            shows the time in the file (default: 0)\n"
 		"  -t <NUM>[/<DEN>], --timecode <NUM>[/<DEN>]\n"
 		"                            use timecode instead of seconds for x-axis;\n"
 		"                            The numerator must be set, the denominator\n"
 		"                            defaults to 1 if omitted.\n"
 		"                            If the value is negative, audio-frames are used.\n"
+		"  --threads <NUM>           read the sound file on NUM threads, and with\n"
+		"                            --compression compress PNG row blocks on\n"
+		"                            them too; with --batch, the number of files\n"
+		"                            drawn at once\n"
+		"  --tile-width <PX>         write the image as tiles PX pixels wide,\n"
+		"                            <png-file> numbered -0000 and so on, with\n"
+		"                            the time range of each in a JSON manifest\n"
+		"                            named <png-file> with a .json extension.\n"
+		"                            Tiles have no border. With --samples-per-pixel\n"
+		"                            the width is the window in pixels of that\n"
+		"                            many frames, so it can be far wider than an\n"
+		"                            image can be.\n"
 		"  -T <offset>               override the BWF time-reference (if any);\n"
 		"                            the offset is specified in audio-frames\n"
 		"                            and only used with timecode (-t) annotation.\n"
@@ -1083,6 +2333,29 @@ usage_exit (char * argv0, int status)
 	exit (status) ;
 } /* usage_exit */
 
+/* Values for the options without a short form. */
+enum
+{	OPT_NO_PEAK = 1,
+	OPT_NO_RMS = 2,
+	OPT_FORMAT = 0x100,
+	OPT_COMPRESSION,
+	OPT_THREADS,
+	OPT_OVERVIEW,
+	OPT_START,
+	OPT_END,
+	OPT_EXPORT,
+	OPT_SAMPLES_PER_PIXEL,
+	OPT_BITS,
+	OPT_RMS_WINDOW,
+	OPT_TILE_WIDTH,
+	OPT_LOUDNESS,
+	OPT_LOUDNESS_COLOUR,
+	OPT_BATCH,
+	OPT_PLAYHEAD,
+	OPT_PLAYHEAD_COLOUR,
+	OPT_PLAYED_COLOUR
+} ;
+
 static struct option const long_options [] =
 {
 	{ "help", no_argument, 0, 'h' },
@@ -1110,8 +2383,26 @@ static struct option const long_options [] =
 	{ "timecode", required_argument, 0, 't' },
 	{ "timeoffset", required_argument, 0, 'T' },
 
-	{ "no-peak", no_argument, 0, 1 },
-	{ "no-rms", no_argument, 0, 2 },
+	{ "no-peak", no_argument, 0, OPT_NO_PEAK },
+	{ "no-rms", no_argument, 0, OPT_NO_RMS },
+
+	{ "format", required_argument, 0, OPT_FORMAT },
+	{ "compression", required_argument, 0, OPT_COMPRESSION },
+	{ "threads", required_argument, 0, OPT_THREADS },
+	{ "overview", optional_argument, 0, OPT_OVERVIEW },
+	{ "start", required_argument, 0, OPT_START },
+	{ "end", required_argument, 0, OPT_END },
+	{ "export", required_argument, 0, OPT_EXPORT },
+	{ "samples-per-pixel", required_argument, 0, OPT_SAMPLES_PER_PIXEL },
+	{ "bits", required_argument, 0, OPT_BITS },
+	{ "rms-window", required_argument, 0, OPT_RMS_WINDOW },
+	{ "tile-width", required_argument, 0, OPT_TILE_WIDTH },
+	{ "loudness", optional_argument, 0, OPT_LOUDNESS },
+	{ "loudnesscolour", required_argument, 0, OPT_LOUDNESS_COLOUR },
+	{ "batch", required_argument, 0, OPT_BATCH },
+	{ "playhead", required_argument, 0, OPT_PLAYHEAD },
+	{ "playheadcolour", required_argument, 0, OPT_PLAYHEAD_COLOUR },
+	{ "playedcolour", required_argument, 0, OPT_PLAYED_COLOUR },
 	{ NULL, 0, NULL, 0 }
 } ;
 
@@ -1120,11 +2411,19 @@ int
 main (int argc, char * argv [])
 {	RENDER render =
 	{	NULL, NULL, NULL,
+		/*overviewpath*/ NULL,
+		/*exportpath*/ NULL, /*samples_per_pixel*/ 0, /*export_bits*/ 16,
+		/*rms_window*/ 0.0,
+		/*tile_width*/ 0,
+		/*loudness*/ false, /*loudnesspath*/ NULL, /*lufs*/ NULL,
+		/*fps*/ 0.0,
+		/*start*/ 0.0, /*end*/ -1.0,
+		/*first*/ 0, /*frames*/ 0,
 		/*width*/ 800, /*height*/ 200,
 		/*channel_separation*/ NORMAL_FONT_SIZE,
 		/*channel*/ 0,
 		/*what*/ PEAK | RMS,
-		/*autogain*/ false,
+		/*autogain*/ false, /*gain*/ 0.0, /*skip*/ 0,
 		/*border*/ false,
 		/*geometry_no_border*/ false,
 		/*logscale*/ false, /*rectified*/ false,
@@ -1134,11 +2433,19 @@ main (int argc, char * argv [])
 		/*annotation*/	{ 1.0, 1.0, 1.0, 1.0 },
 		/*border-bg*/	{ 0.0, 0.0, 0.0, 0.7 },
 		/*center-line*/	{ 1.0, 1.0, 1.0, 0.3 },
+		/*loudness*/	{ 1.0, 0.5, 0.0, 1.0 },
+		/*playhead*/	{ 1.0, 0.0, 0.0, 1.0 },
+		/*played*/		{ 1.0, 1.0, 1.0, 0.25 },
 		/*timecode num*/ 0, /*den*/ 0, /*offset*/ 0.0,
 		/*parse BWF*/ true,
 		/*border-width*/ 2.0f,
+		/*font*/ NULL, /*scratch*/ NULL,
+		/*image*/ { IMAGE_AUTO, -1, 1 },
+		/*target*/ { { 0, 0, NULL } }, /*targets*/ 0,
 		} ;
 
+	const char *batchpath = NULL ;
+	bool ok ;
 	int c ;
 	while ((c = getopt_long (argc, argv,
 				"A:"	/*	--annotation	*/
@@ -1193,13 +2500,39 @@ main (int argc, char * argv [])
 				break ;
 			case 'g' :		/* --geometry*/
 				{
-					char *b = strdup (optarg) ;
-					render.width = atoi (optarg) ;
-					if (strtok (b, "x:/"))
-					{	char *tmp = strtok (NULL, "x:/") ;
-						if (tmp) render.height = atoi (tmp) ;
+					const char *p = optarg + strspn (optarg, "0123456789") ;
+					int width = atoi (optarg), height = 0 ;
+					char sep = *p ;
+
+					/*
+					**	<w>, <w>x<h>, <w>:<h> or <w>/<h> is just a geometry and
+					**	<w>x<h>:<file> adds an image. The file is all after the
+					**	first ':' past the height, so it may hold ':' too.
+					*/
+					if (p > optarg && sep != 0 && strchr ("x:/", sep) != NULL && strspn (p + 1, "0123456789") > 0)
+					{	height = atoi (p + 1) ;
+						p += 1 + strspn (p + 1, "0123456789") ;
+						} ;
+
+					if (p > optarg && *p == 0)
+					{	render.width = width ;
+						if (height > 0)
+							render.height = height ;
+						}
+					else if (height == 0 || sep != 'x' || *p != ':' || p [1] == 0)
+					{	printf ("Error: -g needs <w>x<h> or <w>x<h>:<png-file>, not '%s'\n", optarg) ;
+						exit (EXIT_FAILURE) ;
+						}
+					else if (render.targets < MAX_TARGETS)
+					{	render.target [render.targets].width = width ;
+						render.target [render.targets].height = height ;
+						render.target [render.targets].path = p + 1 ;
+						render.targets ++ ;
+						}
+					else
+					{	printf ("Error: at most %d -g <w>x<h>:<file> images\n", MAX_TARGETS) ;
+						exit (EXIT_FAILURE) ;
 						} ;
-					free (b) ;
 				} ;
 				break ;
 			case 'r' :		/* --rectified */
@@ -1233,13 +2566,88 @@ main (int argc, char * argv [])
 			case 'O' :
 				render.border_width = strtod (optarg, NULL) * 2.0f ;
 				break ;
-			case 1 :
+			case OPT_NO_PEAK :
 				memcpy (&render.c_rms, &render.c_fg, sizeof (COLOUR)) ;
 				render.what &= ~PEAK ;
 				break ;
-			case 2 :
+			case OPT_NO_RMS :
 				render.what &= ~RMS ;
 				break ;
+			case OPT_FORMAT :
+				{	int format = image_format_from_name (optarg) ;
+					if (format < 0)
+					{	printf ("Error: unknown output format '%s'\n", optarg) ;
+						exit (EXIT_FAILURE) ;
+						} ;
+					render.image.format = format ;
+				} ;
+				break ;
+			case OPT_COMPRESSION :
+				render.image.compression = parse_int_or_die (optarg, "compression") ;
+				check_int_range ("compression", render.image.compression, 0, 9) ;
+				break ;
+			case OPT_THREADS :
+				render.image.threads = parse_int_or_die (optarg, "threads") ;
+				check_int_range ("threads", render.image.threads, 1, 256) ;
+				break ;
+			case OPT_OVERVIEW :
+				/* An empty path means the default, next to the sound file. */
+				render.overviewpath = optarg != NULL ? optarg : "" ;
+				break ;
+			case OPT_START :
+				render.start = parse_double_or_die (optarg, "start") ;
+				break ;
+			case OPT_END :
+				render.end = parse_double_or_die (optarg, "end") ;
+				break ;
+			case OPT_EXPORT :
+				render.exportpath = optarg ;
+				break ;
+			case OPT_SAMPLES_PER_PIXEL :
+				render.samples_per_pixel = parse_int_or_die (optarg, "samples-per-pixel") ;
+				check_int_range ("samples-per-pixel", render.samples_per_pixel, 1, INT_MAX) ;
+				break ;
+			case OPT_RMS_WINDOW :
+				render.rms_window = parse_double_or_die (optarg, "rms-window") ;
+				if (render.rms_window <= 0.0)
+				{	printf ("Error: --rms-window must be more than 0\n") ;
+					exit (EXIT_FAILURE) ;
+					} ;
+				break ;
+			case OPT_TILE_WIDTH :
+				render.tile_width = parse_int_or_die (optarg, "tile-width") ;
+				check_int_range ("tile-width", render.tile_width, 1, INT_MAX) ;
+				break ;
+			case OPT_LOUDNESS :
+				render.loudness = true ;
+				render.loudnesspath = optarg ;
+				break ;
+			case OPT_LOUDNESS_COLOUR :
+				set_colour (&render.c_loud, strtoll (optarg, NULL, 16)) ;
+				break ;
+			case OPT_BATCH :
+				batchpath = optarg ;
+				break ;
+			case OPT_PLAYHEAD :
+				render.fps = parse_double_or_die (optarg, "playhead") ;
+				if (render.fps <= 0.0 || render.fps > 1000.0)
+				{	printf ("Error: --playhead must be more than 0 and at most 1000 frames a second\n") ;
+					exit (EXIT_FAILURE) ;
+					} ;
+				break ;
+			case OPT_PLAYHEAD_COLOUR :
+				set_colour (&render.c_head, strtoll (optarg, NULL, 16)) ;
+				break ;
+			case OPT_PLAYED_COLOUR :
+				set_colour (&render.c_played, strtoll (optarg, NULL, 16)) ;
+				break ;
+			case OPT_BITS :
+				render.export_bits = parse_int_or_die (optarg, "bits") ;
+				if (render.export_bits != 8 && render.export_bits != 16)
+				{	printf ("Error: --bits must be 8 or 16\n") ;
+					exit (EXIT_FAILURE) ;
+					} ;
+				break ;
 			case 'V' :
 				printf ("%s %s\n\n", argv [0], PACKAGE_VERSION) ;
 				printf (
@@ -1256,11 +2664,50 @@ main (int argc, char * argv [])
 				usage_exit (argv [0], EXIT_FAILURE) ;
 			} ;
 
-	if (optind + 2 > argc)
+	image_check_options (&render.image) ;
+
+	if (render.tile_width > 0 && (optind + 2 != argc || strcmp (argv [optind + 1], "-") == 0 || render.targets > 0 || render.border))
+	{	printf ("Error: --tile-width needs a <png-file> other than \"-\", and no -b or -g images\n") ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	if (render.fps > 0.0 && render.tile_width > 0)
+	{	printf ("Error: --playhead cannot be used with --tile-width\n") ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	/* Each file of a batch is drawn to its one image, by itself. */
+	if (batchpath != NULL && (optind != argc || render.exportpath != NULL || render.loudness || render.tile_width > 0
+			|| render.targets > 0 || (render.overviewpath != NULL && render.overviewpath [0] != 0)))
+	{	printf ("Error: --batch takes no <sound-file>, --export, --loudness, --overview=<FILE>, --tile-width or -g images\n") ;
+		exit (EXIT_FAILURE) ;
+		} ;
+
+	/* The image is optional when exporting the waveform data, drawing -g images or measuring the loudness. */
+	if (batchpath == NULL && optind + 2 > argc
+			&& ((render.exportpath == NULL && render.targets == 0 && ! render.loudness) || optind + 1 > argc))
 		usage_exit (argv [0], EXIT_FAILURE) ;
 
-	render.sndfilepath = argv [optind] ;
-	render.pngfilepath = argv [optind + 1] ;
+	if (batchpath == NULL)
+	{	render.sndfilepath = argv [optind] ;
+		render.pngfilepath = optind + 1 < argc ? argv [optind + 1] : NULL ;
+		} ;
+
+	/* The loudness is printed on stdout, so no image may be written there too. */
+	if (render.loudness && render.loudnesspath == NULL)
+		for (c = -1 ; c < render.targets ; c++)
+		{	const char *path = c < 0 ? render.pngfilepath : render.target [c].path ;
+
+			if (path != NULL && strcmp (path, "-") == 0)
+			{	printf ("Error: --loudness needs a FILE when an image is written to stdout\n") ;
+				exit (EXIT_FAILURE) ;
+				} ;
+			} ;
+
+	if (render.start < 0.0 || (render.end >= 0.0 && render.end <= render.start))
+	{	printf ("Error: --start must not be negative and --end must be after it\n") ;
+		exit (EXIT_FAILURE) ;
+		} ;
 
 	if ((render.what & (RMS | PEAK)) == 0)
 	{	printf ("Error: at least one of RMS or PEAK must be rendered\n") ;
@@ -1272,11 +2719,22 @@ main (int argc, char * argv [])
 			((!render.geometry_no_border && render.border) ? (TOP_BORDER + BOTTOM_BORDER) : 0),
 			INT_MAX) ;
 
-	render.filename = strrchr (render.sndfilepath, '/') ;
-	render.filename = (render.filename != NULL) ? render.filename + 1 : render.sndfilepath ;
+	for (c = 0 ; c < render.targets ; c++)
+	{	check_int_range ("width", render.target [c].width, MIN_WIDTH, INT_MAX) ;
+		check_int_range ("height", render.target [c].height, MIN_HEIGHT +
+				((!render.geometry_no_border && render.border) ? (TOP_BORDER + BOTTOM_BORDER) : 0),
+				INT_MAX) ;
+		} ;
+
+	render.font = cairo_toy_font_face_create (font_family, CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL) ;
+
+	if (batchpath != NULL)
+		ok = render_batch (&render, batchpath) ;
+	else
+		ok = render_sndfile (&render) ;
 
-	render_sndfile (&render) ;
+	cairo_font_face_destroy (render.font) ;
 
-	return 0 ;
+	return ok ? 0 : EXIT_FAILURE ;
 } /* main */
 // vim: ts=4 sw=4:
@@ -17,16 +17,32 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 
+#include <pthread.h>
+
 #include "window.h"
 
 #define ARRAY_LEN(x)		((int) (sizeof (x) / sizeof (x [0])))
 
+/* Kaiser window parameter used by the spectrogram's --kaiser option. */
+#define	DEFAULT_KAISER_BETA	20.0
+
+typedef struct window_entry
+{	struct window_entry *next ;
+	enum WINDOW_FUNCTION window_function ;
+	int datalen ;
+	double beta ;
+	double data [] ;
+} WINDOW_ENTRY ;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER ;
+static WINDOW_ENTRY *cache_head = NULL ;
 
 static double besseli0 (double x) ;
-static double factorial (int k) ;
+static void mirror_window (double * data, int datalen) ;
 
 void
 calc_kaiser_window (double * data, int datalen, double beta)
@@ -47,12 +63,15 @@ calc_kaiser_window (double * data, int datalen, double beta)
 		exit (1) ;
 		} ;
 
-	for (k = 0 ; k < datalen ; k++)
+	/* The window is symmetric, calculate the first half and mirror it. */
+	for (k = 0 ; k < (datalen + 1) / 2 ; k++)
 	{	double n = k + 0.5 - 0.5 * datalen ;
 		two_n_on_N = (2.0 * n) / datalen ;
 		data [k] = besseli0 (beta * sqrt (1.0 - two_n_on_N * two_n_on_N)) / denom ;
 		} ;
 
+	mirror_window (data, datalen) ;
+
 	return ;
 } /* calc_kaiser_window */
 
@@ -66,6 +85,10 @@ calc_nuttall_window (double * data, int datalen)
 	**	Nuttall window function from :
 	**
 	**	http://en.wikipedia.org/wiki/Window_function
+	**
+	**	Every sample comes from the formula, not mirrored, so that the
+	**	window is the same to the bit as it always was. It is worked out
+	**	once for each length and then cached.
 	*/
 
 	for (k = 0 ; k < datalen ; k++)
@@ -88,6 +111,8 @@ calc_hann_window (double * data, int datalen)
 	**	Hann window function from :
 	**
 	**	http://en.wikipedia.org/wiki/Window_function
+	**
+	**	Not mirrored either, for the same reason as the Nuttall window.
 	*/
 
 	for (k = 0 ; k < datalen ; k++)
@@ -96,51 +121,118 @@ calc_hann_window (double * data, int datalen)
 	return ;
 } /* calc_hann_window */
 
-/*==============================================================================
-*/
-
-static double
-besseli0 (double x)
+void
+calc_window (double * data, int datalen, enum WINDOW_FUNCTION window_function, double beta)
 {	int k ;
-	double result = 0.0 ;
 
-	for (k = 1 ; k < 25 ; k++)
-	{	double temp ;
+	switch (window_function)
+	{	case RECTANGULAR :
+			for (k = 0 ; k < datalen ; k++)
+				data [k] = 1.0 ;
+			break ;
+		case KAISER :
+			calc_kaiser_window (data, datalen, beta > 0.0 ? beta : DEFAULT_KAISER_BETA) ;
+			break ;
+		case NUTTALL:
+			calc_nuttall_window (data, datalen) ;
+			break ;
+		case HANN :
+			calc_hann_window (data, datalen) ;
+			break ;
+		default :
+			printf ("Internal error: Unknown window_function.\n") ;
+			exit (1) ;
+		} ;
 
-		temp = pow (0.5 * x, k) / factorial (k) ;
-		result += temp * temp ;
+	return ;
+} /* calc_window */
+
+const double *
+get_cached_window (enum WINDOW_FUNCTION window_function, int datalen, double beta)
+{	WINDOW_ENTRY *entry ;
+
+	/* beta only makes a difference to the Kaiser window. */
+	if (window_function != KAISER)
+		beta = 0.0 ;
+	else if (beta <= 0.0)
+		beta = DEFAULT_KAISER_BETA ;
+
+	pthread_mutex_lock (&cache_lock) ;
+
+	for (entry = cache_head ; entry != NULL ; entry = entry->next)
+		if (entry->window_function == window_function && entry->datalen == datalen && entry->beta == beta)
+			break ;
+
+	if (entry == NULL)
+	{	entry = malloc (sizeof (WINDOW_ENTRY) + datalen * sizeof (double)) ;
+		if (entry == NULL)
+		{	printf ("%s : Not enough memory.\n", __func__) ;
+			exit (1) ;
+			} ;
+
+		entry->window_function = window_function ;
+		entry->datalen = datalen ;
+		entry->beta = beta ;
+		calc_window (entry->data, datalen, window_function, beta) ;
+
+		entry->next = cache_head ;
+		cache_head = entry ;
 		} ;
 
-	return 1.0 + result ;
-} /* besseli0 */
+	pthread_mutex_unlock (&cache_lock) ;
 
-static double
-factorial (int val)
-{	static double memory [64] = { 1.0 } ;
-	static int have_entry = 0 ;
+	return entry->data ;
+} /* get_cached_window */
 
-	int k ;
+void
+free_window_cache (void)
+{	WINDOW_ENTRY *entry ;
 
-	if (val < 0)
-	{	printf ("Oops : val < 0.\n") ;
-		exit (1) ;
-		} ;
+	pthread_mutex_lock (&cache_lock) ;
 
-	if (val > ARRAY_LEN (memory))
-	{	printf ("Oops : val > ARRAY_LEN (memory).\n") ;
-		exit (1) ;
+	while ((entry = cache_head) != NULL)
+	{	cache_head = entry->next ;
+		free (entry) ;
 		} ;
 
-	if (val < have_entry)
-		return memory [val] ;
+	pthread_mutex_unlock (&cache_lock) ;
+} /* free_window_cache */
+
+/*==============================================================================
+*/
+
+static void
+mirror_window (double * data, int datalen)
+{	int k ;
+
+	for (k = (datalen + 1) / 2 ; k < datalen ; k++)
+		data [k] = data [datalen - 1 - k] ;
+} /* mirror_window */
+
+static double
+besseli0 (double x)
+{	double term = 1.0, result = 1.0, quarter_x2 ;
+	int k ;
 
-	for (k = have_entry + 1 ; k <= val ; k++)
-		memory [k] = k * memory [k - 1] ;
+	/*
+	**	I0 (x) = sum ((x / 2)^k / k!)^2, k = 0 .. inf
+	**
+	**	Each term is the previous one times (x / 2)^2 / k^2, so no pow ()
+	**	or factorials are needed. The terms grow until k is about x / 2
+	**	and then fall off faster than geometrically, so stop once they no
+	**	longer change the result.
+	*/
+	quarter_x2 = 0.25 * x * x ;
 
-	have_entry = val ;
+	for (k = 1 ; k < 500 ; k++)
+	{	term *= quarter_x2 / ((double) k * k) ;
+		result += term ;
+		if (term < result * 1e-17)
+			break ;
+		} ;
 
-	return memory [val] ;
-} /* factorial */
+	return result ;
+} /* besseli0 */
 
 /*==============================================================================
 */
@@ -152,12 +244,6 @@ init_test (void)
 {
 	/* puts (__func__) ;*/
 
-	assert (factorial (0) == 1.0) ;
-	assert (factorial (2) == 2.0) ;
-	assert (factorial (0) == 1.0) ;
-	assert (factorial (5) == 120.0) ;
-	assert (factorial (8) == 40320.0) ;
-
 	assert (fabs (besseli0 (0.0) - 1.0) < 1e-8) ;
 	assert (fabs (besseli0 (0.5) - 1.06348337074132) < 1e-8) ;
 	assert (fabs (besseli0 (1.0) - 1.26606587775201) < 1e-14) ;
@@ -165,4 +251,3 @@ init_test (void)
 	assert (fabs (besseli0 (3.5) - 7.37820343222548) < 1e-14) ;
 
 } /* init_test */
-
@@ -22,3 +22,15 @@ void calc_kaiser_window (double * data, int datalen, double beta) ;
 void calc_nuttall_window (double * data, int datalen) ;
 
 void calc_hann_window (double * data, int datalen) ;
+
+/* Fill data with the given window. beta is the Kaiser window parameter,
+** 0.0 selects the default.
+*/
+void calc_window (double * data, int datalen, enum WINDOW_FUNCTION window_function, double beta) ;
+
+/* Thread safe cache of windows keyed by (type, length, beta). The returned
+** window is shared and stays valid until free_window_cache () is called.
+*/
+const double * get_cached_window (enum WINDOW_FUNCTION window_function, int datalen, double beta) ;
+
+void free_window_cache (void) ;
@@ -19,17 +19,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
 #include <math.h>
 #include <sys/wait.h>
 
 #include <src/common.h>
 
 static void parse_int_test (void) ;
+static void numbered_path_test (void) ;
 
 int
 main (void)
 {
 	parse_int_test () ;
+	numbered_path_test () ;
 	return 0 ;
 } /* main */
 
@@ -85,3 +88,27 @@ parse_int_test (void)
 	fork_parse_int ("die", 0, SF_FALSE) ;
 	puts ("ok") ;
 } /* parse_int_test */
+
+static void
+check_numbered_path (const char * path, int index, const char * expected)
+{	char buf [256] ;
+
+	numbered_path (buf, sizeof (buf), path, index) ;
+	if (strcmp (buf, expected) != 0)
+	{	printf ("Error : numbered_path ('%s', %d) gave '%s', not '%s'\n", path, index, buf, expected) ;
+		exit (1) ;
+		} ;
+} /* check_numbered_path */
+
+static void
+numbered_path_test (void)
+{
+	printf ("%-37s : ", __func__) ;
+	fflush (stdout) ;
+	check_numbered_path ("out.png", 0, "out-0000.png") ;
+	check_numbered_path ("dir.d/out.png", 12, "dir.d/out-0012.png") ;
+	check_numbered_path ("dir.d/out", 3, "dir.d/out-0003") ;
+	check_numbered_path (".hidden", 1, ".hidden-0001") ;
+	check_numbered_path ("-", 7, "-") ;
+	puts ("ok") ;
+} /* numbered_path_test */
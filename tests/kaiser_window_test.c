@@ -23,6 +23,105 @@
 
 #define ARRAY_LEN(x)	((int) ((sizeof (x)) / (sizeof (x [0]))))
 
+/* Reference I0 (x), summing the power series term by term in long double. */
+static long double
+ref_besseli0 (long double x)
+{	long double term = 1.0L, sum = 1.0L ;
+	int k ;
+
+	for (k = 1 ; k < 200 ; k++)
+	{	term *= (x * x / 4.0L) / ((long double) k * k) ;
+		sum += term ;
+		} ;
+
+	return sum ;
+} /* ref_besseli0 */
+
+static void
+accuracy_test (void)
+{	static const double betas [] = { 0.5, 1.0, 8.6, 20.0, 50.0 } ;
+	static const int lengths [] = { 7, 64, 1001 } ;
+	double window [1001], maxerr ;
+	int b, l, k ;
+
+	for (b = 0 ; b < ARRAY_LEN (betas) ; b++)
+		for (l = 0 ; l < ARRAY_LEN (lengths) ; l++)
+		{	int len = lengths [l] ;
+
+			calc_kaiser_window (window, len, betas [b]) ;
+
+			maxerr = 0.0 ;
+			for (k = 0 ; k < len ; k++)
+			{	long double n = k + 0.5L - 0.5L * len ;
+				long double two_n_on_N = 2.0L * n / len ;
+				long double ref = ref_besseli0 (betas [b] * sqrtl (1.0L - two_n_on_N * two_n_on_N)) / ref_besseli0 (betas [b]) ;
+
+				if (fabs ((double) (window [k] - ref)) > maxerr)
+					maxerr = fabs ((double) (window [k] - ref)) ;
+
+				if (window [k] != window [len - 1 - k])
+				{	printf ("\nError (%s %d) : kaiser (%d, %g) not symmetric at %d.\n", __func__, __LINE__, len, betas [b], k) ;
+					exit (1) ;
+					} ;
+				} ;
+
+			if (maxerr > 1e-13)
+			{	printf ("\nError (%s %d) : kaiser (%d, %g) max error %g.\n", __func__, __LINE__, len, betas [b], maxerr) ;
+				exit (1) ;
+				} ;
+			} ;
+
+	for (l = 0 ; l < ARRAY_LEN (lengths) ; l++)
+	{	int len = lengths [l] ;
+
+		calc_hann_window (window, len) ;
+		for (k = 0 ; k < len ; k++)
+			if (fabs (window [k] - 0.5 * (1.0 - cos (2.0 * M_PI * k / (len - 1)))) > 1e-14)
+			{	printf ("\nError (%s %d) : hann (%d) wrong at %d.\n", __func__, __LINE__, len, k) ;
+				exit (1) ;
+				} ;
+
+		calc_nuttall_window (window, len) ;
+		for (k = 0 ; k < len ; k++)
+		{	double scale = M_PI * k / (len - 1) ;
+			double ref = 0.355768 - 0.487396 * cos (2.0 * scale) + 0.144232 * cos (4.0 * scale) - 0.012604 * cos (6.0 * scale) ;
+
+			if (fabs (window [k] - ref) > 1e-14)
+			{	printf ("\nError (%s %d) : nuttall (%d) wrong at %d.\n", __func__, __LINE__, len, k) ;
+				exit (1) ;
+				} ;
+			} ;
+		} ;
+} /* accuracy_test */
+
+static void
+cache_test (void)
+{	double window [512] ;
+	const double *a, *b ;
+	int k ;
+
+	a = get_cached_window (KAISER, ARRAY_LEN (window), 20.0) ;
+	b = get_cached_window (KAISER, ARRAY_LEN (window), 20.0) ;
+	if (a != b)
+	{	printf ("\nError (%s %d) : same key returned different windows.\n", __func__, __LINE__) ;
+		exit (1) ;
+		} ;
+
+	if (get_cached_window (KAISER, ARRAY_LEN (window), 10.0) == a || get_cached_window (HANN, ARRAY_LEN (window), 20.0) == a)
+	{	printf ("\nError (%s %d) : different keys returned the same window.\n", __func__, __LINE__) ;
+		exit (1) ;
+		} ;
+
+	calc_kaiser_window (window, ARRAY_LEN (window), 20.0) ;
+	for (k = 0 ; k < ARRAY_LEN (window) ; k++)
+		if (a [k] != window [k])
+		{	printf ("\nError (%s %d) : cached window differs at %d.\n", __func__, __LINE__, k) ;
+			exit (1) ;
+			} ;
+
+	free_window_cache () ;
+} /* cache_test */
+
 int
 main (void)
 {
@@ -58,6 +157,9 @@ main (void)
 		exit (1) ;
 		} ;
 
+	accuracy_test () ;
+	cache_test () ;
+
 	puts ("ok") ;
 
 	return 0 ;
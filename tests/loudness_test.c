@@ -0,0 +1,142 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+**	Checks the loudness measure against test signals of EBU Tech 3341 and
+**	3342, and that a file measured in parts comes out as it does whole.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <src/common.h>
+#include <src/loudness.h>
+
+#define	MAX_FRAMES		(40 * 48000)
+
+/* Frames added at a time, so the runs split the blocks. */
+#define	RUN_FRAMES		1237
+
+static float data [2 * MAX_FRAMES] ;
+
+/* A stereo sine of freq Hz at level dBFS over frames [start, start + frames). */
+static void
+sine (int samplerate, sf_count_t start, sf_count_t frames, double freq, double phase, double level)
+{	double amp = pow (10.0, level / 20.0) ;
+	sf_count_t k ;
+
+	for (k = start ; k < start + frames ; k++)
+		data [2 * k] = data [2 * k + 1] = amp * sin (2.0 * M_PI * freq * k / samplerate + phase) ;
+} /* sine */
+
+/* Measure frames [start, end) in runs, adding the frames before from first on. */
+static void
+add_frames (LOUDNESS * loudness, sf_count_t first, sf_count_t end)
+{	sf_count_t k ;
+
+	for (k = first ; k < end ; k += RUN_FRAMES)
+		loudness_add (loudness, k, data + 2 * k, (int) MIN (RUN_FRAMES, end - k)) ;
+} /* add_frames */
+
+static void
+measure (int samplerate, sf_count_t frames, LOUDNESS_RESULT * result)
+{	LOUDNESS *loudness ;
+
+	loudness = loudness_create (2, samplerate, 0) ;
+	add_frames (loudness, 0, frames) ;
+	loudness_result (loudness, result) ;
+	loudness_destroy (loudness) ;
+} /* measure */
+
+static void
+check (const char * name, double value, double expected, double tolerance)
+{
+	if (! (fabs (value - expected) <= tolerance))
+	{	printf ("\nError (%s %d) : %s is %.3f, not %.3f.\n", __func__, __LINE__, name, value, expected) ;
+		exit (1) ;
+		} ;
+} /* check */
+
+static void
+parts_test (void)
+{	LOUDNESS_RESULT whole, merged ;
+	LOUDNESS *loudness, *part ;
+	sf_count_t edge [4] = { 0, 300001, 700000, 1000000 } ;
+	int k ;
+
+	srand (1) ;
+	for (k = 0 ; k < 2 * edge [3] ; k++)
+		data [k] = (2.0f * rand () / RAND_MAX - 1.0f) * (k < edge [3] ? 0.1f : 0.5f) ;
+	measure (48000, edge [3], &whole) ;
+
+	loudness = loudness_create (2, 48000, 0) ;
+	for (k = 0 ; k < 3 ; k++)
+	{	part = loudness_part (loudness, edge [k]) ;
+		add_frames (part, MAX (0, edge [k] - loudness_preroll (part)), edge [k + 1]) ;
+		loudness_merge (loudness, part) ;
+		loudness_destroy (part) ;
+		} ;
+	loudness_result (loudness, &merged) ;
+	loudness_destroy (loudness) ;
+
+	check ("integrated loudness in parts", merged.integrated, whole.integrated, 1e-6) ;
+	check ("short-term maximum in parts", merged.short_term_max, whole.short_term_max, 1e-6) ;
+	check ("true peak in parts", merged.true_peak, whole.true_peak, 1e-6) ;
+} /* parts_test */
+
+int
+main (void)
+{	LOUDNESS_RESULT result ;
+
+	printf ("%-37s : ", "loudness_test") ;
+	fflush (stdout) ;
+
+	/* Tech 3341 case 1 : a 1 kHz sine at -23 dBFS is -23 LUFS, at either rate. */
+	sine (48000, 0, 20 * 48000, 1000.0, 0.0, -23.0) ;
+	measure (48000, 20 * 48000, &result) ;
+	check ("integrated loudness", result.integrated, -23.0, 0.1) ;
+	check ("momentary maximum", result.momentary_max, -23.0, 0.1) ;
+	check ("short-term maximum", result.short_term_max, -23.0, 0.1) ;
+
+	sine (44100, 0, 20 * 44100, 1000.0, 0.0, -23.0) ;
+	measure (44100, 20 * 44100, &result) ;
+	check ("integrated loudness at 44.1 kHz", result.integrated, -23.0, 0.1) ;
+
+	/* Tech 3341 case 3, shortened : the quieter parts fall under the relative gate. */
+	sine (48000, 0, 10 * 48000, 1000.0, 0.0, -36.0) ;
+	sine (48000, 10 * 48000, 20 * 48000, 1000.0, 0.0, -23.0) ;
+	sine (48000, 30 * 48000, 10 * 48000, 1000.0, 0.0, -36.0) ;
+	measure (48000, 40 * 48000, &result) ;
+	check ("gated integrated loudness", result.integrated, -23.0, 0.1) ;
+
+	/* Tech 3342 case 1 : 20 s at -20 and 20 s at -30 is a range of 10 LU. */
+	sine (48000, 0, 20 * 48000, 1000.0, 0.0, -20.0) ;
+	sine (48000, 20 * 48000, 20 * 48000, 1000.0, 0.0, -30.0) ;
+	measure (48000, 40 * 48000, &result) ;
+	check ("loudness range", result.range, 10.0, 1.0) ;
+
+	/* A sine at a quarter of the rate, 45 degrees out, peaks between the samples. */
+	sine (48000, 0, 48000, 12000.0, M_PI / 4.0, -6.0) ;
+	measure (48000, 48000, &result) ;
+	check ("true peak", result.true_peak, -6.0, 0.2) ;
+
+	parts_test () ;
+
+	puts ("ok") ;
+	return 0 ;
+} /* main */
@@ -0,0 +1,84 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+**	Checks meter_deflection () against the log meter curve it stands in
+**	for, that it never falls as the coefficient rises, and that
+**	meter_coefficient () undoes it.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <src/meter.h>
+
+/* The curve as sndfile-waveform used to work it out, in doubles. */
+static double
+log_meter (double coeff)
+{	double db = 20.0 * log10 (coeff) ;
+
+	return db < -192.0 ? 0.0 : pow ((db + 192.0) / 192.0, 8.0) ;
+} /* log_meter */
+
+int
+main (void)
+{	double worst = 0.0, worst_coeff = 0.0, d ;
+	float coeff, last = 0.0 ;
+	int k ;
+
+	printf ("%-37s : ", "meter_test") ;
+	fflush (stdout) ;
+
+	/* About 130000 coefficients an octave, from below -192 dB up to 1.0. */
+	for (coeff = 1e-10f ; coeff <= 1.0f ; coeff = nextafterf (coeff, 2.0f) + coeff * 0x1p-17f)
+	{	float value = meter_deflection (coeff) ;
+		double error = fabs (value - log_meter (coeff)) ;
+
+		if (error > worst)
+		{	worst = error ;
+			worst_coeff = coeff ;
+			} ;
+
+		if (value < last)
+		{	printf ("\nError (%s %d) : meter_deflection (%.9g) = %.9g falls from %.9g.\n", __func__, __LINE__, coeff, value, last) ;
+			exit (1) ;
+			} ;
+		last = value ;
+		} ;
+
+	if (worst > METER_MAX_ERROR)
+	{	printf ("\nError (%s %d) : meter_deflection (%.9g) is %g out.\n", __func__, __LINE__, worst_coeff, worst) ;
+		exit (1) ;
+		} ;
+
+	if (meter_deflection (0.0f) != 0.0f || meter_deflection (-0.5f) != 0.0f || meter_deflection (1e-12f) != 0.0f)
+	{	printf ("\nError (%s %d) : not 0.0 below the bottom of the meter.\n", __func__, __LINE__) ;
+		exit (1) ;
+		} ;
+
+	for (k = 1 ; k <= 100 ; k++)
+	{	d = k / 100.0 ;
+		if (fabs (log_meter (meter_coefficient (d)) - d) > 1e-9)
+		{	printf ("\nError (%s %d) : meter_coefficient (%g) = %g is not its inverse.\n", __func__, __LINE__, d, meter_coefficient (d)) ;
+			exit (1) ;
+			} ;
+		} ;
+
+	printf ("%g max error ok\n", worst) ;
+	return 0 ;
+} /* main */
@@ -0,0 +1,220 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+**	Checks the peak kernels against the frame by frame loop sndfile-waveform
+**	used to have and prints how long each takes, and then the short kernel
+**	against the float kernel on the same 16 bit samples. Last, both are
+**	checked against the scalar kernel up to and past KERNEL_CHANNELS, with
+**	the bins apart as peaks_add_float () has them.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include <src/common.h>
+#include <src/peaks.h>
+
+#define	BENCH_FRAMES	(1 << 20)
+#define	BENCH_BLOCK		4093
+#define	BENCH_PASSES	4
+
+/* The old loop : every sample of every frame, picking out one channel. */
+static void
+old_loop (const float * data, int count, int channels, int channel, PEAK_BIN * bin)
+{	int k, ch ;
+
+	for (k = 0 ; k < count ; k++)
+		for (ch = 0 ; ch < channels ; ch++)
+		{	float value = data [k * channels + ch] ;
+
+			if (channel > 0 && ch + 1 != channel)
+				continue ;
+
+			if (value < bin->min)
+				bin->min = value ;
+			if (value > bin->max)
+				bin->max = value ;
+			bin->sumsq += value * value ;
+			bin->count ++ ;
+			} ;
+} /* old_loop */
+
+static void
+clear_bins (PEAK_BIN * bin, int count)
+{	int k ;
+
+	for (k = 0 ; k < count ; k++)
+	{	bin [k].min = 1.0 ;
+		bin [k].max = -1.0 ;
+		bin [k].sumsq = 0.0 ;
+		bin [k].count = 0 ;
+		} ;
+} /* clear_bins */
+
+static double
+seconds (clock_t start)
+{	return (double) (clock () - start) / CLOCKS_PER_SEC ;
+} /* seconds */
+
+static void
+bench (const float * data, int channels)
+{	PEAK_BIN ref [8], got [8] ;
+	int frames = BENCH_FRAMES / channels, pass, k, ch ;
+	double old_time, new_time ;
+	clock_t start ;
+
+	clear_bins (ref, channels) ;
+	start = clock () ;
+	for (pass = 0 ; pass < BENCH_PASSES ; pass++)
+		for (ch = 0 ; ch < channels ; ch++)
+			for (k = 0 ; k < frames ; k += BENCH_BLOCK)
+				old_loop (data + k * channels, MIN (BENCH_BLOCK, frames - k), channels, ch + 1, ref + ch) ;
+	old_time = seconds (start) ;
+
+	clear_bins (got, channels) ;
+	start = clock () ;
+	for (pass = 0 ; pass < BENCH_PASSES ; pass++)
+		for (k = 0 ; k < frames ; k += BENCH_BLOCK)
+			peaks_kernel (data + k * channels, MIN (BENCH_BLOCK, frames - k), channels, got, 1) ;
+	new_time = seconds (start) ;
+
+	for (ch = 0 ; ch < channels ; ch++)
+		if (got [ch].min != ref [ch].min || got [ch].max != ref [ch].max || got [ch].count != ref [ch].count
+				|| fabs (got [ch].sumsq - ref [ch].sumsq) > 1e-5 * ref [ch].sumsq)
+		{	printf ("\nError (%s %d) : %d channels, channel %d : %g %g %g != %g %g %g.\n", __func__, __LINE__, channels, ch,
+					got [ch].min, got [ch].max, got [ch].sumsq, ref [ch].min, ref [ch].max, ref [ch].sumsq) ;
+			exit (1) ;
+			} ;
+
+	printf ("\n    %d channels : %8.2f ms -> %8.2f ms", channels, 1000.0 * old_time, 1000.0 * new_time) ;
+} /* bench */
+
+static void
+bench_short (const short * data, const float * fdata, int channels)
+{	PEAK_BIN ref [8], got [8] ;
+	int frames = BENCH_FRAMES / channels, pass, k, ch ;
+	double float_time, short_time ;
+	clock_t start ;
+
+	clear_bins (ref, channels) ;
+	start = clock () ;
+	for (pass = 0 ; pass < BENCH_PASSES ; pass++)
+		for (k = 0 ; k < frames ; k += BENCH_BLOCK)
+			peaks_kernel (fdata + k * channels, MIN (BENCH_BLOCK, frames - k), channels, ref, 1) ;
+	float_time = seconds (start) ;
+
+	clear_bins (got, channels) ;
+	start = clock () ;
+	for (pass = 0 ; pass < BENCH_PASSES ; pass++)
+		for (k = 0 ; k < frames ; k += BENCH_BLOCK)
+			peaks_kernel_short (data + k * channels, MIN (BENCH_BLOCK, frames - k), channels, got, 1) ;
+	short_time = seconds (start) ;
+
+	for (ch = 0 ; ch < channels ; ch++)
+		if (got [ch].min != ref [ch].min || got [ch].max != ref [ch].max || got [ch].count != ref [ch].count
+				|| fabs (got [ch].sumsq - ref [ch].sumsq) > 1e-5 * ref [ch].sumsq)
+		{	printf ("\nError (%s %d) : %d channels, channel %d : %g %g %g != %g %g %g.\n", __func__, __LINE__, channels, ch,
+					got [ch].min, got [ch].max, got [ch].sumsq, ref [ch].min, ref [ch].max, ref [ch].sumsq) ;
+			exit (1) ;
+			} ;
+
+	printf ("\n    %d channels short : %8.2f ms -> %8.2f ms", channels, 1000.0 * float_time, 1000.0 * short_time) ;
+} /* bench_short */
+
+static void
+check_bins (const PEAK_BIN * got, const PEAK_BIN * ref, int channels, int bin_stride, const char * name)
+{	int k ;
+
+	for (k = 0 ; k < channels * bin_stride ; k++)
+		if (got [k].min != ref [k].min || got [k].max != ref [k].max || got [k].count != ref [k].count
+				|| fabs (got [k].sumsq - ref [k].sumsq) > 1e-5 * ref [k].sumsq)
+		{	printf ("\nError (%s %d) : %s, %d channels, bin stride %d, bin %d : %g %g %g != %g %g %g.\n", __func__, __LINE__,
+					name, channels, bin_stride, k, got [k].min, got [k].max, got [k].sumsq, ref [k].min, ref [k].max, ref [k].sumsq) ;
+			exit (1) ;
+			} ;
+} /* check_bins */
+
+/* data holds the float values of sdata. */
+static void
+check_kernels (const short * sdata, const float * data, int channels, int bin_stride)
+{	PEAK_BIN ref [(KERNEL_CHANNELS + 1) * 3], got [(KERNEL_CHANNELS + 1) * 3] ;
+	int frames = BENCH_FRAMES / channels, k ;
+
+	/* Clear the whole arrays, the bins between the strides are never written. */
+	clear_bins (ref, ARRAY_LEN (ref)) ;
+	for (k = 0 ; k < frames ; k += BENCH_BLOCK)
+		peaks_kernel_scalar (data + k * channels, MIN (BENCH_BLOCK, frames - k), channels, ref, bin_stride) ;
+
+	clear_bins (got, ARRAY_LEN (got)) ;
+	for (k = 0 ; k < frames ; k += BENCH_BLOCK)
+		peaks_kernel (data + k * channels, MIN (BENCH_BLOCK, frames - k), channels, got, bin_stride) ;
+	check_bins (got, ref, channels, bin_stride, "float") ;
+
+	clear_bins (got, ARRAY_LEN (got)) ;
+	for (k = 0 ; k < frames ; k += BENCH_BLOCK)
+		peaks_kernel_short (sdata + k * channels, MIN (BENCH_BLOCK, frames - k), channels, got, bin_stride) ;
+	check_bins (got, ref, channels, bin_stride, "short") ;
+} /* check_kernels */
+
+int
+main (void)
+{	static const int channels [] = { 1, 2, 4, 6, 7 } ;
+	static const int checked [] = { 1, 2, 7, 8, KERNEL_CHANNELS, KERNEL_CHANNELS + 1 } ;
+	float *data ;
+	short *sdata ;
+	int k ;
+
+	printf ("%-37s : %s", "peak_kernel_bench", peaks_kernel_name ()) ;
+	fflush (stdout) ;
+
+	if ((data = malloc (BENCH_FRAMES * sizeof (float))) == NULL
+			|| (sdata = malloc (BENCH_FRAMES * sizeof (short))) == NULL)
+	{	printf ("\nError (%s %d) : malloc failed.\n", __func__, __LINE__) ;
+		exit (1) ;
+		} ;
+
+	srand (1) ;
+	for (k = 0 ; k < BENCH_FRAMES ; k++)
+		data [k] = 2.0f * rand () / RAND_MAX - 1.0f ;
+
+	for (k = 0 ; k < ARRAY_LEN (channels) ; k++)
+		bench (data, channels [k]) ;
+
+	/* Full scale both ways, so the squares of -32768 are covered. */
+	for (k = 0 ; k < BENCH_FRAMES ; k++)
+	{	sdata [k] = k % 4099 == 0 ? -32768 : (short) lrint (32767.0 * data [k]) ;
+		data [k] = sdata [k] / 32768.0f ;
+		} ;
+
+	for (k = 0 ; k < ARRAY_LEN (channels) ; k++)
+		bench_short (sdata, data, channels [k]) ;
+
+	for (k = 0 ; k < ARRAY_LEN (checked) ; k++)
+	{	check_kernels (sdata, data, checked [k], 1) ;
+		check_kernels (sdata, data, checked [k], 3) ;
+		} ;
+
+	free (data) ;
+	free (sdata) ;
+
+	puts ("\nok") ;
+
+	return 0 ;
+} /* main */
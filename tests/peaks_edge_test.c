@@ -0,0 +1,83 @@
+/*
+** Copyright (C) 2026 The libsndfile team
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 2 or version 3 of the
+** License.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+**	Checks that the bins split very long files exactly, a frame at a time
+**	at each edge, where the product of the bins and the frames is far too
+**	big for 64 bits.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <src/common.h>
+#include <src/peaks.h>
+
+/* A week at 96 kHz. */
+#define	WEEK_FRAMES		(7LL * 24 * 3600 * 96000)
+
+static void
+check_edges (sf_count_t frames, int bins)
+{	PEAKS peaks = { bins, 1, frames, 0, NULL } ;
+	sf_count_t size = frames / bins, i ;
+	int step = MAX (1, bins / 4099) ;
+
+	if (peaks_edge (&peaks, 0) != 0 || peaks_edge (&peaks, bins) != frames)
+	{	printf ("\nError (%s %d) : %lld frames, %d bins : the bins span %lld to %lld.\n", __func__, __LINE__,
+				(long long) frames, bins, (long long) peaks_edge (&peaks, 0), (long long) peaks_edge (&peaks, bins)) ;
+		exit (1) ;
+		} ;
+
+	/* Every bin within a frame of the same size, and each edge frame in the right bin. */
+	for (i = 0 ; i < bins ; i += i + step < bins - 3 ? step : 1)
+	{	int k = (int) i ;
+		sf_count_t first = peaks_edge (&peaks, k), end = peaks_edge (&peaks, k + 1) ;
+
+		if (end - first < size || end - first > size + 1)
+		{	printf ("\nError (%s %d) : %lld frames, %d bins : bin %d is %lld frames.\n", __func__, __LINE__,
+					(long long) frames, bins, k, (long long) (end - first)) ;
+			exit (1) ;
+			} ;
+
+		if (end > first && (peaks_bin (&peaks, first) != k || peaks_bin (&peaks, end - 1) != k))
+		{	printf ("\nError (%s %d) : %lld frames, %d bins : frames %lld and %lld are in bins %d and %d, not %d.\n",
+					__func__, __LINE__, (long long) frames, bins, (long long) first, (long long) (end - 1),
+					peaks_bin (&peaks, first), peaks_bin (&peaks, end - 1), k) ;
+			exit (1) ;
+			} ;
+		} ;
+} /* check_edges */
+
+int
+main (void)
+{	static const int bins [] = { 1, 7, 1000, 8640000, 1000000007, 2147483647 } ;
+	int k ;
+
+	printf ("%-37s : ", "peaks_edge_test") ;
+	fflush (stdout) ;
+
+	for (k = 0 ; k < ARRAY_LEN (bins) ; k++)
+	{	check_edges (WEEK_FRAMES, bins [k]) ;
+		check_edges (WEEK_FRAMES + 12345, bins [k]) ;
+		check_edges (((sf_count_t) 1 << 46) - 1, bins [k]) ;
+		} ;
+
+	check_edges (100, 1000) ;
+
+	puts ("ok") ;
+	return 0 ;
+} /* main */
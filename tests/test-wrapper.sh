@@ -54,6 +54,29 @@ testwrap bin/sndfile-resample -to 48000 -c 4 $tmpdir/chirp.wav $tmpdir/chirp2.wa
 testwrap bin/sndfile-spectrogram $tmpdir/chirp.wav 640 480 $tmpdir/chirp.png
 testwrap bin/sndfile-waveform $tmpdir/chirp.wav $tmpdir/wavform.png
 
+# The tiles of an image, put side by side, must be the image byte for byte.
+function tiletest {
+	width=800
+	height=120
+	tile=300
+	printf "%-37s : " "waveform tiles join up"
+	bin/sndfile-waveform -c -1 -g ${width}x${height} --format rgba $1 $tmpdir/whole.rgba > $logfile 2>&1
+	bin/sndfile-waveform -c -1 -g ${width}x${height} --format rgba --tile-width $tile $1 $tmpdir/tile.rgba >> $logfile 2>&1
+	for ((x = 0 ; x < width ; x += tile)) ; do
+		w=$((width - x < tile ? width - x : tile))
+		t=$(printf "%04d" $((x / tile)))
+		for ((y = 0 ; y < height ; y++)) ; do
+			if ! cmp -s -n $((4 * w)) $tmpdir/whole.rgba $tmpdir/tile-$t.rgba $((4 * (y * width + x))) $((4 * y * w)) ; then
+				echo "tile $t differs from the image at row $y"
+				exit 1
+				fi
+			done
+		done
+	echo "ok"
+}
+
+tiletest $tmpdir/chirp.wav
+
 
 
 rm -rf ./$tmpdir